@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "globals.h"
+
+// Tiny benchmark harness for snake_bench
+// Benchmarks register themselves with BENCHMARK(name) and report results as CSV rows:
+// benchmark,case,value,unit
+
+using BenchmarkFn = void (*)();
+
+struct Benchmark {
+    const char* name;
+    BenchmarkFn run;
+};
+
+std::vector<Benchmark>& benchmark_registry();
+
+struct BenchmarkRegistration {
+    BenchmarkRegistration(const char* name, BenchmarkFn run) {
+        benchmark_registry().push_back({name, run});
+    }
+};
+
+#define BENCHMARK(name) \
+    static void bench_##name(); \
+    static BenchmarkRegistration bench_registration_##name(#name, bench_##name); \
+    static void bench_##name()
+
+void report(const char* benchmark, const std::string& case_name, double value, const char* unit);
+
+// Keeps the optimizer from discarding a computed value
+template<typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// sorted_percentile (batch.h) of samples. Sorts samples
+double percentile(std::vector<double>& samples, double p);
+
+// Nanoseconds per call of fn averaged over `iterations` calls
+template<typename Fn>
+double time_per_call_ns(u32 iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < iterations; ++i)
+        fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
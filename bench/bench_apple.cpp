@@ -0,0 +1,34 @@
+#include "bench.h"
+#include "board_gen.h"
+#include "random_utils.h"
+
+// The old apple placement: redraw random coordinates until one is free
+static void spawn_apple_rejection(GameState<DefaultDims>& state) {
+    do {
+        state.apple_position[0] = random_int(0, WIDTH - 1);
+        state.apple_position[1] = random_int(0, HEIGHT - 1);
+    } while (state.board.test(state.apple_position[0], state.apple_position[1]));
+}
+
+// Apple spawn latency against board fill
+BENCHMARK(apple_spawn) {
+    static GameState<DefaultDims> state;
+    const double fills[] = {0.0, 0.5, 0.8, 0.9, 0.95, 0.99, 0.999};
+
+    for (double fill : fills) {
+        make_filled_state(state, fill, 1);
+        std::string fill_name = "fill=" + std::to_string(fill).substr(0, 5);
+
+        double free_cells_ns = time_per_call_ns(1000000, [] {
+            spawn_apple(state);
+            do_not_optimize(state.apple_position);
+        });
+        double rejection_ns = time_per_call_ns(fill > 0.99 ? 10000 : 200000, [] {
+            spawn_apple_rejection(state);
+            do_not_optimize(state.apple_position);
+        });
+
+        report("apple_spawn", "free_cells/" + fill_name, free_cells_ns, "ns");
+        report("apple_spawn", "rejection/" + fill_name, rejection_ns, "ns");
+    }
+}
@@ -0,0 +1,34 @@
+#include <algorithm>
+
+#include "bench.h"
+#include "arena.h"
+
+// Arena ticks per second against the decision thread count, with thousands of snakes on a large board
+BENCHMARK(arena) {
+    const DynamicDims dims(512, 512);
+    const u32 warmup_ticks = 50;
+    const u32 ticks = 200;
+
+    std::vector<u32> thread_counts = {1, 2, 4, 8, default_thread_count()};
+    std::sort(thread_counts.begin(), thread_counts.end());
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+    for (u32 threads : thread_counts) {
+        ArenaOptions options;
+        options.snakes = 4096;
+        options.apples = 4096;
+        options.threads = threads;
+        options.seed = 1;
+        Arena<DynamicDims> arena(options, dims);
+        init_arena(arena);
+        for (u32 i = 0; i < warmup_ticks; ++i) {
+            arena_tick(arena);
+        }
+
+        double ns = time_per_call_ns(ticks, [&] { arena_tick(arena); });
+        const std::string name = std::to_string(threads) + "_threads";
+        report("arena", name + "/ticks", 1e9 / ns, "ticks/s");
+        report("arena", name + "/snake_moves", options.snakes * 1e9 / ns, "moves/s");
+    }
+    report("arena", "hardware_threads", default_thread_count(), "threads");
+}
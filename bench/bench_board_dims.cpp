@@ -0,0 +1,35 @@
+#include <memory>
+
+#include "bench.h"
+#include "board_dims.h"
+#include "random_utils.h"
+#include "simulation.h"
+
+// Headless Blind Snake ticks per second on one board size
+template<typename D>
+static double ticks_per_second(const D& dims, u32 games) {
+    auto state = std::make_unique<GameState<D>>(dims);
+    Controller<D> controller(ControllerKind::BLIND, dims);
+    seed_rng(1);
+
+    u64 ticks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 game = 0; game < games; ++game) {
+        ticks += run_headless_game(*state, controller).ticks;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return ticks / elapsed.count();
+}
+
+// Cost of the runtime-sized fallback: the same boards played through a prebuilt FixedDims and through DynamicDims
+BENCHMARK(board_dims) {
+    auto compare = [](auto fixed, u32 games) {
+        using D = decltype(fixed);
+        std::string size_name = std::to_string(D::width) + "x" + std::to_string(D::height);
+        report("board_dims", "fixed/" + size_name, ticks_per_second(fixed, games), "ticks/s");
+        report("board_dims", "dynamic/" + size_name, ticks_per_second(DynamicDims(D::width, D::height), games), "ticks/s");
+    };
+    compare(Board20x20{}, 2000);
+    compare(Board53x30{}, 500);
+    compare(Board128x128{}, 50);
+}
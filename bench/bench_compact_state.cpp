@@ -0,0 +1,42 @@
+#include <memory>
+
+#include "bench.h"
+#include "board_gen.h"
+#include "compact_state.h"
+
+// Forks per second: a CompactState snapshot and restore through a SnapshotArena, against copying a whole GameState
+template<typename D>
+static void bench_forks(const D& dims) {
+    const std::string size_name = std::to_string(dims.width) + "x" + std::to_string(dims.height);
+    const u32 forks = 1000000;
+
+    auto state = std::make_unique<GameState<D>>(dims);
+    auto copy = std::make_unique<GameState<D>>(dims);
+    make_filled_state(*state, 0.5, 1);
+
+    auto base = std::make_unique<CompactState<D>>(dims);
+    auto work = std::make_unique<CompactState<D>>(dims);
+    compact_state(*state, *base);
+    SnapshotArena<D> arena(64, dims);
+
+    double compact_ns = time_per_call_ns(forks, [&] {
+        const u32 mark = arena.mark();
+        arena.restore(arena.snapshot(*base), *work);
+        arena.release(mark);
+        do_not_optimize(work->head);
+    });
+    double game_state_ns = time_per_call_ns(forks, [&] {
+        *copy = *state;
+        do_not_optimize(copy->ticks);
+    });
+
+    report("fork", "compact/" + size_name, 1e9 / compact_ns, "forks/s");
+    report("fork", "game_state/" + size_name, 1e9 / game_state_ns, "forks/s");
+    report("fork", "compact_bytes/" + size_name, sizeof(CompactState<D>), "bytes");
+    report("fork", "game_state_bytes/" + size_name, sizeof(GameState<D>), "bytes");
+}
+
+BENCHMARK(fork) {
+    bench_forks(DefaultDims{});
+    bench_forks(Board128x128{});
+}
@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
+
+#include "bench.h"
+#include "hamiltonctl.h"
+#include "random_utils.h"
+#include "simulation.h"
+
+// Cycle tables for the largest board: building one, opening it without a cache file (build, write and map)
+// and opening it again from the cache file, which only maps it
+BENCHMARK(hamilton_cache) {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / ("snake_bench_hamilton_" + std::to_string(::getpid()));
+    const char* previous = std::getenv("SNAKE_CACHE_DIR");
+    const std::string previous_dir = previous != nullptr ? previous : "";
+    ::setenv("SNAKE_CACHE_DIR", directory.c_str(), 1);
+
+    const u16 side = MAX_BOARD_LENGTH;
+    std::vector<u32> table(usize(side) * side);
+    auto start = std::chrono::steady_clock::now();
+    build_hamilton_cycle(side, side, table.data());
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    do_not_optimize(table.data());
+    report("hamilton_cache", "4096x4096/build", elapsed.count(), "ms");
+
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<const HamiltonCycle> cold = open_hamilton_cycle(side, side);
+    elapsed = std::chrono::steady_clock::now() - start;
+    report("hamilton_cache", "4096x4096/cold_open", elapsed.count(), "ms");
+    report("hamilton_cache", "4096x4096/cold_mapped", cold->file != nullptr, "bool");
+    cold.reset();
+
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<const HamiltonCycle> warm = open_hamilton_cycle(side, side);
+    elapsed = std::chrono::steady_clock::now() - start;
+    do_not_optimize(warm->position[usize(side) * side - 1]);
+    report("hamilton_cache", "4096x4096/warm_open", elapsed.count(), "ms");
+    warm.reset();
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    if (previous != nullptr)
+        ::setenv("SNAKE_CACHE_DIR", previous_dir.c_str(), 1);
+    else
+        ::unsetenv("SNAKE_CACHE_DIR");
+}
+
+// Whole games with the Hamiltonian controller next to the Blind Snake on the same seeds: how many fill the
+// board, how long they take, and the per-decision latency of both over the positions of real games
+BENCHMARK(hamilton) {
+    using D = DefaultDims;
+    const u32 games = 10;
+    auto state = std::make_unique<GameState<D>>();
+
+    for (ControllerKind kind : {ControllerKind::BLIND, ControllerKind::HAMILTON}) {
+        Controller<D> controller(kind);
+        const std::string name = controller_kind_name(kind);
+        u32 full = 0;
+        double length = 0;
+        double ticks = 0;
+        double decide_ns = 0;
+        for (u32 game = 0; game < games; ++game) {
+            seed_rng(derive_seed(1, game));
+            GameSummary summary = run_headless_game(*state, controller);
+            full += summary.death_cause == DeathCause::BOARD_FULL;
+            length += summary.length;
+            ticks += summary.ticks;
+
+            // The same game again, timing only the decisions
+            seed_rng(derive_seed(1, game));
+            init_game(*state);
+            bool alive = true;
+            while (alive && state->ticks < summary.ticks) {
+                auto start = std::chrono::steady_clock::now();
+                Direction dir = controller.decide(*state);
+                decide_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                alive = step(*state, dir);
+            }
+        }
+        report("hamilton", name + "/board_full", double(full) / games, "games");
+        report("hamilton", name + "/mean_length", length / games, "tiles");
+        report("hamilton", name + "/mean_ticks", ticks / games, "ticks");
+        report("hamilton", name + "/decide", decide_ns / ticks, "ns");
+    }
+}
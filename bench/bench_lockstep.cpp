@@ -0,0 +1,46 @@
+#include <chrono>
+#include <memory>
+
+#include "bench.h"
+#include "lockstep.h"
+#include "random_utils.h"
+#include "simulation.h"
+
+// Blind Snake game ticks per second on one thread: one scalar game at a time against lockstep batches of growing
+// width, plus the mean final length of both, which should agree (same move probabilities, different streams)
+BENCHMARK(lockstep) {
+    const u32 games = 2000;
+
+    auto state = std::make_unique<GameState<DefaultDims>>();
+    Controller<DefaultDims> controller(ControllerKind::BLIND);
+    u64 ticks = 0;
+    u64 length = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < games; ++i) {
+        seed_rng(derive_seed(1, i));
+        const GameSummary summary = run_headless_game(*state, controller);
+        ticks += summary.ticks;
+        length += summary.length;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    report("lockstep", "scalar/ticks", ticks / elapsed.count(), "ticks/s");
+    report("lockstep", "scalar/mean_length", double(length) / games, "tiles");
+
+    for (u32 lanes : {16u, 64u, 256u, 1024u}) {
+        const std::string name = std::to_string(lanes) + "_lanes";
+        auto batch = std::make_unique<LockstepBatch<DefaultDims>>(lanes, 1, games);
+        start = std::chrono::steady_clock::now();
+        while (batch->active_count > 0) {
+            batch->tick();
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        ticks = 0;
+        length = 0;
+        for (const GameSummary& summary : batch->results) {
+            ticks += summary.ticks;
+            length += summary.length;
+        }
+        report("lockstep", name + "/ticks", ticks / elapsed.count(), "ticks/s");
+        report("lockstep", name + "/mean_length", double(length) / games, "tiles");
+    }
+}
@@ -0,0 +1,44 @@
+#include "bench.h"
+#include "board_gen.h"
+#include "pathctl.h"
+#include "snakectl.h"
+
+// Per-decision latency of pathfinder_decide (p50/p99) against board fill, with snake_decide for reference
+BENCHMARK(pathfinder_decide) {
+    static GameState<DefaultDims> state;
+    static Pathfinder<DefaultDims> pathfinder;
+    const double fills[] = {0.1, 0.25, 0.5, 0.75, 0.9};
+    const u32 samples_per_fill = 20000;
+
+    std::vector<double> path_ns, blind_ns;
+    path_ns.reserve(samples_per_fill);
+    blind_ns.reserve(samples_per_fill);
+
+    for (double fill : fills) {
+        make_filled_state(state, fill, 1);
+        std::string fill_name = "fill=" + std::to_string(fill).substr(0, 4);
+        path_ns.clear();
+        blind_ns.clear();
+
+        for (u32 i = 0; i < samples_per_fill; ++i) {
+            // New apple every sample so the searches cover the whole free area
+            spawn_apple(state);
+
+            auto start = std::chrono::steady_clock::now();
+            Direction dir = pathfinder_decide(pathfinder, state);
+            auto middle = std::chrono::steady_clock::now();
+            Direction blind_dir = snake_decide(state.apple_position, head_position(state), state.snake.direction, state.board);
+            auto end = std::chrono::steady_clock::now();
+            do_not_optimize(dir);
+            do_not_optimize(blind_dir);
+
+            path_ns.push_back(std::chrono::duration<double, std::nano>(middle - start).count());
+            blind_ns.push_back(std::chrono::duration<double, std::nano>(end - middle).count());
+        }
+
+        report("pathfinder_decide", "path/p50/" + fill_name, percentile(path_ns, 0.5), "ns");
+        report("pathfinder_decide", "path/p99/" + fill_name, percentile(path_ns, 0.99), "ns");
+        report("pathfinder_decide", "blind/p50/" + fill_name, percentile(blind_ns, 0.5), "ns");
+        report("pathfinder_decide", "blind/p99/" + fill_name, percentile(blind_ns, 0.99), "ns");
+    }
+}
@@ -0,0 +1,99 @@
+#include <memory>
+
+#include "bench.h"
+#include "board_gen.h"
+#include "controller.h"
+#include "reachability.h"
+
+// Naive reference: BFS over the free tiles from start, counting them
+static u32 naive_region_size(const Bitboard<DefaultDims>& board, u32 start, u16* queue, u8* visited) {
+    const DefaultDims dims;
+    for (u32 i = 0; i < dims.cells; ++i) {
+        visited[i] = 0;
+    }
+    u32 front = 0, back = 0;
+    queue[back++] = start;
+    visited[start] = 1;
+    while (front < back) {
+        u32 cell = queue[front++];
+        for (u8 dir = 0; dir < 4; ++dir) {
+            u32 next;
+            if (!dims.neighbor_cell(cell, dir, next) || visited[next])
+                continue;
+            if (board.test_cell(next))
+                continue;
+            visited[next] = 1;
+            queue[back++] = next;
+        }
+    }
+    return back;
+}
+
+// Cost per tick of knowing the region size behind every possible move:
+// incremental Reachability (sync + queries) against a naive BFS and a bitboard flood fill per direction
+BENCHMARK(reachability) {
+    const DefaultDims dims;
+    static GameState<DefaultDims> state;
+    static u16 queue[DefaultDims::cells];
+    static u8 visited[DefaultDims::cells];
+    static Bitboard<DefaultDims> region;
+    auto reachability = std::make_unique<Reachability<DefaultDims>>();
+    Controller<DefaultDims> mover(ControllerKind::PATHFINDER);
+
+    const double fills[] = {0.5, 0.8, 0.95};
+    const u32 ticks_per_fill = 2000;
+
+    for (double fill : fills) {
+        std::string fill_name = "fill=" + std::to_string(fill).substr(0, 4);
+        double incremental_ns = 0, naive_ns = 0, bitboard_ns = 0;
+        u32 ticks = 0;
+        u64 seed = 1;
+
+        make_filled_state(state, fill, seed);
+        while (ticks < ticks_per_fill) {
+            const u32 head = state.snake.body.back();
+            u32 sum_incremental = 0, sum_naive = 0, sum_bitboard = 0;
+
+            auto t0 = std::chrono::steady_clock::now();
+            reachability->sync(state);
+            for (u8 dir = 0; dir < 4; ++dir) {
+                sum_incremental += reachability->reachable_after_move(head, static_cast<Direction>(dir));
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            for (u8 dir = 0; dir < 4; ++dir) {
+                u32 next;
+                if (dims.neighbor_cell(head, dir, next) && !state.board.test_cell(next))
+                    sum_naive += naive_region_size(state.board, next, queue, visited);
+            }
+            auto t2 = std::chrono::steady_clock::now();
+            for (u8 dir = 0; dir < 4; ++dir) {
+                u32 next;
+                if (dims.neighbor_cell(head, dir, next) && !state.board.test_cell(next)) {
+                    std::array<u16, 2> p = dims.cell_position(next);
+                    sum_bitboard += flood_fill(state.board, p[0], p[1], region);
+                }
+            }
+            auto t3 = std::chrono::steady_clock::now();
+            do_not_optimize(sum_incremental);
+            do_not_optimize(sum_naive);
+            do_not_optimize(sum_bitboard);
+
+            // The first tick of every board is a full rebuild. Only steady-state ticks count
+            if (reachability->synced && state.ticks > 0) {
+                incremental_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+                naive_ns += std::chrono::duration<double, std::nano>(t2 - t1).count();
+                bitboard_ns += std::chrono::duration<double, std::nano>(t3 - t2).count();
+                ticks++;
+            }
+
+            // Keep the snake at about the same length, and start over on a fresh board if it dies
+            state.snake.grow_timer = 0;
+            if (!step(state, mover.decide(state)))
+                make_filled_state(state, fill, ++seed);
+        }
+
+        report("reachability", "incremental/" + fill_name, incremental_ns / ticks, "ns/tick");
+        report("reachability", "naive_bfs/" + fill_name, naive_ns / ticks, "ns/tick");
+        report("reachability", "bitboard_fill/" + fill_name, bitboard_ns / ticks, "ns/tick");
+    }
+}
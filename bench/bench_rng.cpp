@@ -0,0 +1,42 @@
+#include <random>
+
+#include "bench.h"
+#include "random_utils.h"
+
+// The previous random_int: a std::uniform_int_distribution built for every draw, from a std::mt19937
+template<typename T>
+static T random_int_mt19937(std::mt19937& rng, T min, T max) {
+    std::uniform_int_distribution<T> dist(min, max);
+    return dist(rng);
+}
+
+// Draws per second of random_int against the old mt19937 + distribution path, for the ranges the engine uses:
+// the Blind Snake's coin flips and choices (tiny ranges) and apple spawns (up to the whole board)
+BENCHMARK(rng) {
+    const u32 draws = 20000000;
+    struct Range {
+        const char* name;
+        u32 max;
+    };
+    const Range ranges[] = {{"coin", 1}, {"choice", 3}, {"board", 53 * 30 - 1}, {"large_board", 4096u * 4096u - 1}};
+
+    seed_rng(1);
+    std::mt19937 mt(1);
+    for (const Range& range : ranges) {
+        u32 sum = 0;
+        double fast_ns = time_per_call_ns(draws, [&] { sum += random_int(u32(0), range.max); });
+        double mt_ns = time_per_call_ns(draws, [&] { sum += random_int_mt19937(mt, u32(0), range.max); });
+        do_not_optimize(sum);
+
+        report("rng", std::string("xoshiro256/") + range.name, 1e9 / fast_ns, "draws/s");
+        report("rng", std::string("mt19937_distribution/") + range.name, 1e9 / mt_ns, "draws/s");
+    }
+
+    // Raw 64-bit outputs, no range reduction
+    Xoshiro256& rng = get_rng();
+    u64 sum = 0;
+    report("rng", "xoshiro256/raw", 1e9 / time_per_call_ns(draws, [&] { sum += rng(); }), "draws/s");
+    std::mt19937_64 mt64(1);
+    report("rng", "mt19937_64/raw", 1e9 / time_per_call_ns(draws, [&] { sum += mt64(); }), "draws/s");
+    do_not_optimize(sum);
+}
@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <memory>
+
+#include "bench.h"
+#include "random_utils.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+// Rollout controller against its thread count: rollouts per second within the per-tick budget, and how long
+// the snake gets (decision quality) on the same seeds, next to the Blind Snake it uses as its rollout policy
+BENCHMARK(rollout) {
+    using D = Board20x20;
+    const u32 games = 3;
+    RolloutOptions options;
+    options.budget_us = 300;
+
+    auto state = std::make_unique<GameState<D>>();
+    auto mean_length = [&](Controller<D>& controller) {
+        double length = 0;
+        for (u32 game = 0; game < games; ++game) {
+            seed_rng(derive_seed(1, game));
+            length += run_headless_game(*state, controller).length;
+        }
+        return length / games;
+    };
+
+    Controller<D> blind(ControllerKind::BLIND);
+    report("rollout", "blind/mean_length", mean_length(blind), "tiles");
+
+    std::vector<u32> thread_counts = {1, 2, 4, default_thread_count()};
+    std::sort(thread_counts.begin(), thread_counts.end());
+    thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+    for (u32 threads : thread_counts) {
+        options.threads = threads;
+        Controller<D> controller(ControllerKind::ROLLOUT, D(), options);
+        const std::string name = std::to_string(threads) + "_threads";
+        report("rollout", name + "/mean_length", mean_length(controller), "tiles");
+        report("rollout", name + "/rollouts", controller.rollout->rollouts / controller.rollout->busy_seconds, "rollouts/s");
+        report("rollout", name + "/rollouts_per_decision", double(controller.rollout->rollouts) / controller.rollout->decisions, "rollouts");
+    }
+    report("rollout", "hardware_threads", default_thread_count(), "threads");
+}
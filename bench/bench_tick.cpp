@@ -0,0 +1,113 @@
+#include <memory>
+
+#include "bench.h"
+#include "batch.h"
+#include "board_gen.h"
+#include "controller.h"
+#include "random_utils.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+static const ControllerKind CONTROLLER_KINDS[] = {ControllerKind::BLIND, ControllerKind::BLIND_REACHABILITY, ControllerKind::PATHFINDER, ControllerKind::HAMILTON};
+
+// Per-decision latency (p50/p99) of every controller against board fill
+BENCHMARK(decide) {
+    static GameState<DefaultDims> state;
+    const double fills[] = {0.1, 0.25, 0.5, 0.75, 0.9};
+    const u32 samples_per_fill = 10000;
+
+    std::vector<double> samples;
+    samples.reserve(samples_per_fill);
+
+    for (ControllerKind kind : CONTROLLER_KINDS) {
+        Controller<DefaultDims> controller(kind);
+        std::string name = controller_kind_name(kind);
+
+        for (double fill : fills) {
+            make_filled_state(state, fill, 1);
+            std::string fill_name = "fill=" + std::to_string(fill).substr(0, 4);
+            samples.clear();
+
+            for (u32 i = 0; i < samples_per_fill; ++i) {
+                // New apple every sample so the decisions cover the whole free area
+                spawn_apple(state);
+
+                auto start = std::chrono::steady_clock::now();
+                Direction dir = controller.decide(state);
+                auto end = std::chrono::steady_clock::now();
+                do_not_optimize(dir);
+                samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+            }
+
+            report("decide", name + "/p50/" + fill_name, percentile(samples, 0.5), "ns");
+            report("decide", name + "/p99/" + fill_name, percentile(samples, 0.99), "ns");
+        }
+    }
+}
+
+// Full tick (decide + step) against board fill. The snake is kept at the same length, and a dead snake starts
+// over on a fresh board with the next seed, which is not timed
+BENCHMARK(tick) {
+    static GameState<DefaultDims> state;
+    const double fills[] = {0.1, 0.5, 0.9};
+    const u32 ticks_per_fill = 20000;
+
+    for (ControllerKind kind : CONTROLLER_KINDS) {
+        Controller<DefaultDims> controller(kind);
+        std::string name = controller_kind_name(kind);
+
+        for (double fill : fills) {
+            std::string fill_name = "fill=" + std::to_string(fill).substr(0, 4);
+            u64 seed = 1;
+            make_filled_state(state, fill, seed);
+
+            double elapsed_ns = 0;
+            u32 ticks = 0;
+            while (ticks < ticks_per_fill) {
+                // Run until death or the tick budget, then account for the whole stretch at once
+                auto start = std::chrono::steady_clock::now();
+                bool alive = true;
+                while (alive && ticks < ticks_per_fill) {
+                    state.snake.grow_timer = 0;
+                    alive = step(state, controller.decide(state));
+                    ticks++;
+                }
+                elapsed_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                if (!alive)
+                    make_filled_state(state, fill, ++seed);
+            }
+
+            report("tick", name + "/" + fill_name, elapsed_ns / ticks, "ns/tick");
+        }
+    }
+}
+
+// End to end: whole headless games from a fresh board, on one thread and spread over every core
+BENCHMARK(headless_games) {
+    for (ControllerKind kind : CONTROLLER_KINDS) {
+        std::string name = controller_kind_name(kind);
+        // Pathfinder games are about 10x longer than Blind Snake games, and its decisions cost more. Hamiltonian
+        // games always fill the board, so they are the longest of all
+        const u32 games = (kind == ControllerKind::BLIND) ? 2000 : (kind == ControllerKind::BLIND_REACHABILITY) ? 500 : 20;
+
+        auto state = std::make_unique<GameState<DefaultDims>>();
+        Controller<DefaultDims> controller(kind);
+        u64 ticks = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < games; ++i) {
+            seed_rng(derive_seed(1, i));
+            ticks += run_headless_game(*state, controller).ticks;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        report("headless_games", name + "/1_thread/games", games / elapsed.count(), "games/s");
+        report("headless_games", name + "/1_thread/ticks", ticks / elapsed.count(), "ticks/s");
+
+        const u32 threads = default_thread_count();
+        start = std::chrono::steady_clock::now();
+        std::vector<GameSummary> results = run_batch(games * threads, threads, 1, kind);
+        elapsed = std::chrono::steady_clock::now() - start;
+        do_not_optimize(results.data());
+        report("headless_games", name + "/all_threads/games", results.size() / elapsed.count(), "games/s");
+    }
+    report("headless_games", "all_threads", default_thread_count(), "threads");
+}
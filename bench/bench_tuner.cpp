@@ -0,0 +1,25 @@
+#include "bench.h"
+#include "thread_pool.h"
+#include "tuner.h"
+
+// Grid search over the Blind Snake's parameters on a small board, with and without early stopping: how long a
+// whole search takes, how many games it needs, and whether stopping early changes the winner
+BENCHMARK(tuner) {
+    TuneOptions options;
+    options.games = 400;
+    options.threads = default_thread_count();
+    options.seed = 1;
+
+    for (double stop_sigmas : {0.0, 3.0}) {
+        options.stop_sigmas = stop_sigmas;
+        const std::string name = stop_sigmas > 0 ? "early_stopping" : "no_early_stopping";
+        TuneResult result = run_tuner(20, 20, options);
+        report("tuner", name + "/seconds", result.seconds, "s");
+        report("tuner", name + "/games", double(result.games), "games");
+        report("tuner", name + "/candidates_per_second", result.candidates / result.seconds, "candidates/s");
+        report("tuner", name + "/stopped_early", double(result.stopped_early) / result.candidates, "share");
+        report("tuner", name + "/best_mean_length", result.best_score.mean, "tiles");
+        report("tuner", name + "/default_mean_length", result.default_score.mean, "tiles");
+    }
+    report("tuner", "threads", default_thread_count(), "threads");
+}
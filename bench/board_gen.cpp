@@ -0,0 +1,37 @@
+#include "board_gen.h"
+#include "random_utils.h"
+
+template<typename D>
+void make_filled_state(GameState<D>& state, double fill, u64 seed) {
+    seed_rng(seed);
+    init_game(state);
+
+    const D& dims = state.dims;
+    u32 length = static_cast<u32>(fill * dims.cells);
+    if (length < 1)
+        length = 1;
+    if (length > dims.cells - 1)
+        length = dims.cells - 1;
+
+    state.board.clear();
+    state.free_cells.fill();
+    state.snake.body.clear();
+
+    // Tail at (0, 0), snaking along the rows. The head ends up at the end of the path
+    for (u32 i = 0; i < length; ++i) {
+        u16 y = i / dims.width;
+        u16 x = (y % 2 == 0) ? i % dims.width : dims.width - 1 - i % dims.width;
+        state.board.set(x, y);
+        state.free_cells.remove(dims.cell_index(x, y));
+        state.snake.body.push_back(static_cast<typename D::cell_t>(dims.cell_index(x, y)));
+    }
+
+    u16 head_y = head_position(state)[1];
+    state.snake.direction = (head_y % 2 == 0) ? RIGHT : LEFT;
+    state.snake.grow_timer = 0;
+    spawn_apple(state);
+}
+
+#define INSTANTIATE(D) \
+    template void make_filled_state(GameState<D>&, double, u64);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
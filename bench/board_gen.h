@@ -0,0 +1,10 @@
+#pragma once
+#include "board_dims.h"
+#include "game.h"
+
+// Seeded board states for benchmarks, so runs on different commits see the same boards
+
+// Resets state to a snake that covers `fill` (0 to 1) of the board, laid out row by row in a
+// boustrophedon, with the apple on a random free tile
+template<typename D>
+void make_filled_state(GameState<D>& state, double fill, u64 seed);
@@ -0,0 +1,37 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "bench.h"
+#include "batch.h"
+
+std::vector<Benchmark>& benchmark_registry() {
+    static std::vector<Benchmark> registry;
+    return registry;
+}
+
+void report(const char* benchmark, const std::string& case_name, double value, const char* unit) {
+    std::cout << benchmark << ',' << case_name << ',' << value << ',' << unit << std::endl;
+}
+
+double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return sorted_percentile(samples, p);
+}
+
+// Usage: snake_bench [name...]
+// Runs the named benchmarks, or all of them when no name is given
+int main(int argc, char* argv[]) {
+    std::cout << "benchmark,case,value,unit" << std::endl;
+
+    for (const Benchmark& benchmark : benchmark_registry()) {
+        bool selected = (argc == 1);
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], benchmark.name) == 0)
+                selected = true;
+        }
+        if (selected)
+            benchmark.run();
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "globals.h"
+#include "bitboard.h"
+#include "board_dims.h"
+#include "random_utils.h"
+#include "ring_buffer.h"
+#include "thread_pool.h"
+
+// Arena mode: many Blind Snakes and many apples on one shared board, for load-testing controller logic
+// A tick has two phases:
+// - Decide, in parallel: every snake picks its target apple and runs snake_decide against the board as it was at
+//   the start of the tick. Nothing shared is written, and each chunk of snakes draws from its own seeded stream,
+//   so the decisions do not depend on the thread count or scheduling
+// - Resolve, serially: moves are checked against the start-of-tick board. A snake dies when it leaves the board,
+//   moves onto a body tile that is not a tail being vacated this tick, or moves onto the same tile as another
+//   snake (all of them die, so a head-on meeting kills both). Two snakes swapping heads die the same way, since
+//   each moves onto the other's head. Then tails leave, dead snakes are cleared, and heads move in
+// Dead snakes respawn as new one-tile snakes on a random free tile, so the number of snakes stays the same
+
+struct ArenaOptions {
+    u32 snakes = 1000;
+    u32 apples = 1000; // Kept on the board at all times (as long as there is room)
+    u32 threads = 1;   // Decision workers. 1 decides on the calling thread
+    u64 seed = 0;
+};
+
+struct ArenaStats {
+    u64 ticks = 0;
+    u64 deaths = 0;
+    u64 apples_eaten = 0;
+};
+
+struct ArenaSnake {
+    RingBuffer<u32, 0> body; // Cells. Tail at the front, head at the back. Doubles in capacity when full
+    Direction direction;
+    u8 grow_timer;
+    bool alive;
+    u32 target; // Cell of the apple the snake is heading for
+    u32 next;   // Cell the snake decided to move to this tick, or NO_CELL when that leaves the board
+
+    ArenaSnake() : body(8), direction(START_DIRECTION), grow_timer(0), alive(false), target(0), next(0) {}
+};
+
+template<typename D>
+struct Arena {
+    static constexpr u32 NO_CELL = ~u32(0);
+    static constexpr u32 FREE = 0;
+
+    D dims;
+    ArenaOptions options;
+    Bitboard<D> board;                        // Set on every snake tile, for snake_decide
+    Buffer<u32, D::fixed_cells> owner;        // Snake index + 1 on every snake tile, FREE elsewhere
+    Buffer<u32, D::fixed_cells> apple_slot;   // Index + 1 into apples, 0 where there is no apple
+    Buffer<u32, D::fixed_cells> claims;       // Snakes moving onto each cell this tick
+    std::vector<u32> apples;                  // Cells with an apple
+    std::vector<ArenaSnake> snakes;
+    std::vector<u32> claimed;                 // Cells with claims this tick, to reset them afterwards
+    std::vector<u32> dying;                   // Snakes killed this tick
+    std::unique_ptr<ThreadPool> pool;         // Only with more than one thread
+    Xoshiro256 rng;                           // Serial phase: apple spawns and respawns
+    ArenaStats stats;
+
+    explicit Arena(const ArenaOptions& options, const D& dims = D());
+
+    u32 alive_count() const;
+    u32 longest_snake() const;
+};
+
+// Fills an empty arena with options.snakes one-tile snakes and options.apples apples
+template<typename D>
+void init_arena(Arena<D>& arena);
+
+// Plays one tick for every snake
+template<typename D>
+void arena_tick(Arena<D>& arena);
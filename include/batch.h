@@ -0,0 +1,39 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "globals.h"
+#include "simulation.h"
+
+// Aggregated results of a batch of games
+struct BatchStats {
+    u32 games;
+    double seconds;
+    double games_per_second;
+
+    double mean_length;
+    u32 median_length;
+    u32 p99_length;
+
+    double mean_ticks;
+    u32 median_ticks;
+    u32 p99_ticks;
+};
+
+// Plays `games` independent headless games on a width x height board spread over `threads` workers
+// Game i is seeded with derive_seed(master_seed, i), so results don't depend on the thread count or scheduling
+// (except with the rollout controller, whose decisions depend on timing). Rollouts run on the game's own worker
+std::vector<GameSummary> run_batch(u32 games, u32 threads, u64 master_seed, ControllerKind controller_kind,
+                                   u16 width = WIDTH, u16 height = HEIGHT, const RolloutOptions& rollout = RolloutOptions(),
+                                   const BlindParams& blind = BlindParams());
+
+BatchStats summarize_batch(const std::vector<GameSummary>& results, double seconds);
+
+// Nearest-rank p (0 to 1) percentile of a list sorted in ascending order. T() for an empty list
+template<typename T>
+T sorted_percentile(const std::vector<T>& sorted, double p) {
+    if (sorted.empty())
+        return T();
+    const usize rank = static_cast<usize>(p * sorted.size() + 0.999999);
+    return sorted[std::clamp<usize>(rank, 1, sorted.size()) - 1];
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "globals.h"
+#include "board_dims.h"
+
+// One bit per tile, 1 where the snake is
+// Every row starts on a fresh 64-bit word (dims.row_words per row). The padding bits past the board width
+// at the end of each row are always 1, so they act as walls and ~word is exactly the free tiles of that word.
+// All whole-board queries work a word (64 tiles) at a time
+template<typename D>
+struct Bitboard {
+    D dims;
+    Buffer<u64, D::fixed_words> words;
+
+    explicit Bitboard(const D& dims = D());
+
+    // Every tile free
+    void clear();
+
+    bool test(u16 x, u16 y) const {
+        return (words[y * dims.row_words + x / 64] >> (x % 64)) & 1;
+    }
+
+    void set(u16 x, u16 y) {
+        words[y * dims.row_words + x / 64] |= u64(1) << (x % 64);
+    }
+
+    void reset(u16 x, u16 y) {
+        words[y * dims.row_words + x / 64] &= ~(u64(1) << (x % 64));
+    }
+
+    bool test_cell(u32 cell) const {
+        std::array<u16, 2> p = dims.cell_position(cell);
+        return test(p[0], p[1]);
+    }
+
+    // Bit d (indexed by Direction) is set if moving from (x, y) in direction d lands on a free tile on the board
+    u8 free_neighbors(u16 x, u16 y) const;
+
+    // Number of free tiles
+    u32 count_free() const;
+
+    // Bits of the last word in a row that lie past the board width
+    u64 padding_mask() const {
+        return (dims.width % 64 == 0) ? 0 : ~u64(0) << (dims.width % 64);
+    }
+};
+
+// For every tile, whether its neighbor in each direction is a free tile on the board
+// out[d] has bit (x, y) set if the tile one step from (x, y) in direction d is free. Padding bits are 0
+template<typename D>
+void neighbor_free_masks(const Bitboard<D>& board, Bitboard<D> out[4]);
+
+// Fills region with the free tiles 4-connected to (x, y), which must be free, and returns how many there are
+// Grows the region by shifting and masking whole rows until nothing changes
+template<typename D>
+u32 flood_fill(const Bitboard<D>& board, u16 x, u16 y, Bitboard<D>& region);
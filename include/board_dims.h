@@ -0,0 +1,156 @@
+#pragma once
+#include <array>
+#include <type_traits>
+#include <vector>
+
+#include "globals.h"
+
+// The engine is templated on the board dimensions D, which is either
+// - FixedDims<W, H>: width and height are compile-time constants, so indexing constant-folds and all
+//   per-tile storage is inline (a GameState is trivially copyable), or
+// - DynamicDims: width and height are chosen at runtime, and per-tile storage is allocated once at setup
+// Code reads the sizes through an instance (dims.width), which compiles to a constant for FixedDims.
+// Tiles are addressed by a packed cell index (row-major) wherever compactness matters
+
+// Helpers shared by both kinds of dimensions
+template<typename Derived>
+struct DimsOps {
+    u32 cell_index(u16 x, u16 y) const {
+        return u32(y) * self().width + x;
+    }
+
+    std::array<u16, 2> cell_position(u32 cell) const {
+        return {static_cast<u16>(cell % self().width), static_cast<u16>(cell / self().width)};
+    }
+
+    // Neighbor of cell one step in direction dir. Returns false if that would leave the board
+    bool neighbor_cell(u32 cell, u8 dir, u32& out) const {
+        u32 x = cell % self().width;
+        u32 y = cell / self().width;
+        switch (dir) {
+            case UP:
+                if (y + 1 >= self().height) return false;
+                out = cell + self().width;
+                return true;
+            case DOWN:
+                if (y == 0) return false;
+                out = cell - self().width;
+                return true;
+            case LEFT:
+                if (x == 0) return false;
+                out = cell - 1;
+                return true;
+            case RIGHT:
+                if (x + 1 >= self().width) return false;
+                out = cell + 1;
+                return true;
+        }
+        return false;
+    }
+
+    // Direction of a step between two neighboring cells
+    Direction direction_between(u32 from, u32 to) const {
+        if (to == from + self().width) return UP;
+        if (to + self().width == from) return DOWN;
+        if (to == from + 1) return RIGHT;
+        return LEFT;
+    }
+
+    // Where the snake's head starts. The rest of its START_LENGTH tiles trail off to the left
+    std::array<u16, 2> start_position() const {
+        return {static_cast<u16>(self().width / 2), static_cast<u16>(self().height / 2)};
+    }
+
+private:
+    const Derived& self() const { return static_cast<const Derived&>(*this); }
+};
+
+template<u16 W, u16 H>
+struct FixedDims : DimsOps<FixedDims<W, H>> {
+    static_assert(W >= 2 && H >= 1, "Board too small");
+
+    static constexpr u16 width = W;
+    static constexpr u16 height = H;
+    static constexpr u32 cells = u32(W) * H;
+    static constexpr u32 row_words = (W + 63) / 64; // Bitboard words per row
+    static constexpr u32 board_words = row_words * H;
+
+    // Compile-time sizes for Buffer (0 means "sized at runtime")
+    static constexpr u32 fixed_cells = cells;
+    static constexpr u32 fixed_words = board_words;
+
+    // Smallest type that can hold any cell index plus two sentinel values
+    using cell_t = std::conditional_t<(cells < 0xFFFE), u16, u32>;
+};
+
+struct DynamicDims : DimsOps<DynamicDims> {
+    u16 width;
+    u16 height;
+    u32 cells;
+    u32 row_words;
+    u32 board_words;
+
+    static constexpr u32 fixed_cells = 0;
+    static constexpr u32 fixed_words = 0;
+
+    using cell_t = u32;
+
+    DynamicDims(u16 width, u16 height)
+        : width(width), height(height), cells(u32(width) * height),
+          row_words((width + 63u) / 64u), board_words(row_words * height) {}
+};
+
+// Fixed-size storage: inline std::array when N is known at compile time, otherwise a vector sized once by resize
+template<typename T, u32 N>
+struct Buffer {
+    std::array<T, N> items;
+
+    void resize(u32) {}
+    T& operator[](u32 i) { return items[i]; }
+    const T& operator[](u32 i) const { return items[i]; }
+};
+
+template<typename T>
+struct Buffer<T, 0> {
+    std::vector<T> items;
+
+    void resize(u32 n) { items.assign(n, T()); }
+    T& operator[](u32 i) { return items[i]; }
+    const T& operator[](u32 i) const { return items[i]; }
+};
+
+// Largest --width/--height. Keeps every cell index of a DynamicDims board well inside u32
+constexpr u16 MAX_BOARD_LENGTH = 4096;
+
+// ========== PREBUILT BOARD SIZES ========== //
+
+// Board sizes with a compile-time specialized engine. Any other size runs on DynamicDims
+using Board10x10 = FixedDims<10, 10>;
+using Board20x20 = FixedDims<20, 20>;
+using Board32x32 = FixedDims<32, 32>;
+using Board53x30 = FixedDims<53, 30>;
+using Board64x64 = FixedDims<64, 64>;
+using Board100x100 = FixedDims<100, 100>;
+using Board128x128 = FixedDims<128, 128>;
+
+// The window's own board (WIDTH x HEIGHT tiles)
+using DefaultDims = FixedDims<WIDTH, HEIGHT>;
+static_assert(std::is_same_v<DefaultDims, Board53x30>, "The default board should be a prebuilt size");
+
+#define SNAKE_FOR_EACH_FIXED_DIMS(X) \
+    X(Board10x10) X(Board20x20) X(Board32x32) X(Board53x30) X(Board64x64) X(Board100x100) X(Board128x128)
+
+// Every D the engine is compiled for. Engine sources end with SNAKE_FOR_EACH_DIMS(INSTANTIATE)
+#define SNAKE_FOR_EACH_DIMS(X) \
+    SNAKE_FOR_EACH_FIXED_DIMS(X) X(DynamicDims)
+
+// Calls fn with the FixedDims matching width x height if there is one, otherwise with DynamicDims
+template<typename Fn>
+auto with_board_dims(u16 width, u16 height, Fn&& fn) {
+#define SNAKE_DISPATCH_DIMS(D) \
+    if (width == D::width && height == D::height) \
+        return fn(D{});
+    SNAKE_FOR_EACH_FIXED_DIMS(SNAKE_DISPATCH_DIMS)
+#undef SNAKE_DISPATCH_DIMS
+    return fn(DynamicDims(width, height));
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <memory>
+#include <string>
+
+#include "globals.h"
+#include "bitboard.h"
+#include "board_texture.h"
+#include "board_vertices.h"
+#include "game.h"
+#include "tile_layout.h"
+
+enum class RendererKind : u8 {
+    VERTEX = 0, // BoardVertices: 2 triangles per tile
+    TEXTURE     // BoardTexture: one byte per tile and a fragment shader
+};
+
+// Draws the board with the selected renderer, and counts what it uploads
+struct BoardRenderer {
+    RendererKind kind;
+    std::unique_ptr<BoardVertices> vertices;
+    std::unique_ptr<BoardTexture> texture;
+
+    // Last step applied, while interpolate is drawing it part way
+    StepEvents fading;
+    bool interpolated;
+
+    // For --render-stats
+    UploadCounters total; // Every upload, including resets
+    u64 frames;           // Number of flushes
+    u64 tile_changes;     // set_tile calls
+
+    BoardRenderer(RendererKind kind, const TileLayout& layout);
+
+    // Sets every tile from board, and the apple
+    template<typename D>
+    void reset(const GameState<D>& state);
+
+    void set_tile(u16 x, u16 y, Tile tile);
+
+    // Updates the tiles changed by a game step
+    // Does not remove previous apple tiles. This should not be necessary because snake head should overwrite it
+    void apply_step(const StepEvents& events, std::array<u16, 2> apple_position);
+
+    // Draws the last step alpha (0 to 1) of the way done: the new head fades in and the old tail fades out
+    // The next apply_step or reset settles those tiles on their real colors first
+    void interpolate(float alpha, std::array<u16, 2> apple_position);
+
+    // Sends this frame's changes to the GPU. Call once per frame, before draw
+    void flush();
+
+    void draw(sf::RenderTarget& target) const;
+
+private:
+    // Undoes interpolate
+    void settle(std::array<u16, 2> apple_position);
+};
+
+// Command line names: "vertex", "texture". Returns false for an unknown name
+bool parse_renderer_kind(const std::string& name, RendererKind& kind);
+
+const char* renderer_kind_name(RendererKind kind);
@@ -0,0 +1,38 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+#include "globals.h"
+#include "bitboard.h"
+#include "tile_layout.h"
+
+// The board as a texture of tile values, drawn as one quad by a fragment shader that maps values to colors
+// Memory is one byte per tile whatever the board size (BoardVertices needs 120). SFML textures are RGBA8, so each
+// texel packs 4 neighboring tiles of a row, one per channel. Changed rows are uploaded once per frame by flush()
+struct BoardTexture {
+    TileLayout layout;
+    u32 texture_width;       // Texels per row: ceil(layout.width / 4)
+    std::vector<u8> tiles;   // CPU copy of texture, row-major, texture_width * 4 bytes per row
+    std::vector<u32> dirty;  // Rows changed since the last flush, each listed once
+    std::vector<u8> dirty_flags;
+    sf::Texture texture;
+    sf::Shader shader;
+    sf::Vertex quad[6];
+
+    explicit BoardTexture(const TileLayout& layout);
+
+    // Sets every tile from board and uploads the whole texture
+    template<typename D>
+    UploadCounters reset(const Bitboard<D>& board);
+
+    void set_tile(u16 x, u16 y, Tile tile);
+
+    // Draws fade_in blending from black to its tile and fade_out from white to its tile, alpha (0 to 1) of the
+    // way. (-1, -1) for no tile. Only changes shader uniforms, nothing is uploaded
+    void set_fade(sf::Vector2f fade_in, sf::Vector2f fade_out, float alpha);
+
+    // Uploads every dirty row. Call once per frame, before draw
+    UploadCounters flush();
+
+    void draw(sf::RenderTarget& target) const;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+
+#include "globals.h"
+#include "bitboard.h"
+#include "tile_layout.h"
+
+// Set a square (6 vertices) to a color
+void set_square_vertices_color(sf::Vertex* vertices, sf::Color color);
+
+// Set the positions of each vertex (2 triangles, 6 vertices) to make a square
+void set_square_vertices_positions(sf::Vertex* vertices, const TileLayout& layout, u16 x, u16 y);
+
+// The board as a vertex buffer of 2 triangles per tile
+// Color changes only touch a CPU-side copy of the vertices and mark the tile dirty. flush() sends the dirty tiles
+// to the GPU once per frame, sorted and merged into as few contiguous ranges as possible
+struct BoardVertices {
+    TileLayout layout;
+    sf::VertexBuffer buffer;
+    std::vector<sf::Vertex> vertices; // CPU copy of buffer, 6 per tile in cell index order
+    std::vector<u32> dirty;           // Cell index of every tile changed since the last flush, each listed once
+    std::vector<u8> dirty_flags;      // 1 if the tile is in dirty
+
+    explicit BoardVertices(const TileLayout& layout);
+
+    // Colors every tile from board (white for the snake) and uploads the whole buffer
+    template<typename D>
+    UploadCounters reset(const Bitboard<D>& board);
+
+    void set_tile(u16 x, u16 y, Tile tile);
+
+    // Any color, for tiles part way between two tiles (see BoardRenderer::interpolate)
+    void set_color(u16 x, u16 y, sf::Color color);
+
+    // Uploads every dirty tile. Call once per frame, before draw
+    UploadCounters flush();
+
+    void draw(sf::RenderTarget& target) const;
+};
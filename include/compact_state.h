@@ -0,0 +1,122 @@
+#pragma once
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "globals.h"
+#include "bitboard.h"
+#include "board_dims.h"
+#include "game.h"
+
+// Bit-packed game state for lookahead
+// A GameState keeps a packed cell index per body segment plus the free cell set, which is what makes its steps
+// and apple spawns O(1) but also makes it ~10 KB on the default board. This keeps only the board bits and one
+// 2-bit direction per body segment (from each segment to the next, tail first), so a fork is a memcpy of well
+// under 1 KB on the default board. With FixedDims it is trivially copyable; with DynamicDims copying it into a
+// state of the same size reuses the existing storage, so it does not allocate either.
+// It can be stepped directly. Apples are drawn by selecting a random free bit of the board, which is O(board words)
+// and draws different apples than a GameState would from the same seed, so use it for hypotheticals, not replays
+template<typename D>
+struct CompactState {
+    static constexpr u32 BODY_WORDS = (D::fixed_cells * 2 + 63) / 64; // 32 segments per word. 0 for DynamicDims
+
+    D dims;
+    u32 tail;        // Cell of the tail
+    u32 head;        // Cell of the head
+    u32 length;      // Body segments, head and tail included
+    u32 first_link;  // Ring index of the link leaving the tail
+    u32 apple;       // Cell of the apple
+    u32 ticks;
+    u32 last_apple_tick;
+    Direction direction;
+    u8 grow_timer;
+    DeathCause death_cause;
+    GameRules rules;
+    Bitboard<D> board;
+    Buffer<u64, BODY_WORDS> links; // Ring of length - 1 directions, each from one segment to the next
+
+    explicit CompactState(const D& dims = D()) : dims(dims), tail(0), head(0), length(0), first_link(0), apple(0), ticks(0),
+        last_apple_tick(0), direction(START_DIRECTION), grow_timer(0), death_cause(DeathCause::NONE), board(dims) {
+        links.resize((dims.cells * 2 + 63) / 64);
+    }
+
+    Direction link(u32 i) const {
+        return static_cast<Direction>((links[i / 32] >> (2 * (i % 32))) & 3);
+    }
+
+    void set_link(u32 i, Direction dir) {
+        u64& word = links[i / 32];
+        word = (word & ~(u64(3) << (2 * (i % 32)))) | (u64(dir) << (2 * (i % 32)));
+    }
+
+    // Ring index i links after the tail's
+    u32 link_index(u32 i) const {
+        u32 index = first_link + i;
+        return index >= dims.cells ? index - dims.cells : index;
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<CompactState<DefaultDims>>, "Forks of a fixed-size CompactState must be a memcpy");
+
+// Packs state into out, which must have the same dims
+template<typename D>
+void compact_state(const GameState<D>& state, CompactState<D>& out);
+
+// Unpacks compact into out, which must have the same dims. Rebuilds the free cell set, so O(board)
+template<typename D>
+void expand_state(const CompactState<D>& compact, GameState<D>& out);
+
+// Same rules as step on a GameState. Returns false once the game is over (see state.death_cause)
+template<typename D>
+bool step(CompactState<D>& state, Direction direction);
+
+// Puts the apple on a uniformly random free tile
+template<typename D>
+void spawn_apple(CompactState<D>& state);
+
+template<typename D>
+inline u32 snake_length(const CompactState<D>& state) {
+    return state.length;
+}
+
+template<typename D>
+inline std::array<u16, 2> head_position(const CompactState<D>& state) {
+    return state.dims.cell_position(state.head);
+}
+
+template<typename D>
+inline std::array<u16, 2> apple_position(const CompactState<D>& state) {
+    return state.dims.cell_position(state.apple);
+}
+
+// Preallocated stack of snapshots for search
+// Every slot is allocated up front, so taking and restoring snapshots is a plain copy into existing storage.
+// Search code takes a mark() before exploring a branch and release()s back to it afterwards
+template<typename D>
+struct SnapshotArena {
+    std::vector<CompactState<D>> slots;
+    u32 used;
+
+    explicit SnapshotArena(u32 capacity, const D& dims = D()) : slots(capacity, CompactState<D>(dims)), used(0) {}
+
+    // Copies state into the next free slot and returns its index. Throws std::runtime_error when the arena is full
+    u32 snapshot(const CompactState<D>& state) {
+        if (used == slots.size())
+            throw(std::runtime_error("Snapshot arena is full"));
+        slots[used] = state;
+        return used++;
+    }
+
+    // Copies snapshot index back into state
+    void restore(u32 index, CompactState<D>& state) const {
+        state = slots[index];
+    }
+
+    const CompactState<D>& operator[](u32 index) const { return slots[index]; }
+
+    u32 mark() const { return used; }
+
+    // Drops every snapshot taken since mark
+    void release(u32 mark) { used = mark; }
+};
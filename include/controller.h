@@ -0,0 +1,45 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include "globals.h"
+#include "board_dims.h"
+#include "game.h"
+#include "hamiltonctl.h"
+#include "pathctl.h"
+#include "player_input.h"
+#include "reachability.h"
+#include "rolloutctl.h"
+#include "snakectl.h"
+
+enum class ControllerKind : u8 {
+    BLIND = 0,          // snake_decide
+    BLIND_REACHABILITY, // snake_decide with incremental region tracking to avoid dead ends
+    PATHFINDER,         // pathfinder_decide
+    ROLLOUT,            // rollout_decide
+    HAMILTON,           // hamilton_decide
+    PLAYER              // Keyboard, through PlayerInput. Only in a window
+};
+
+// Picks the next direction with the selected AI
+// Owns whatever scratch space that AI needs, so make one per game (or per worker thread) and reuse it
+template<typename D>
+struct Controller {
+    ControllerKind kind;
+    std::unique_ptr<Pathfinder<D>> pathfinder;
+    std::unique_ptr<Reachability<D>> reachability;
+    std::unique_ptr<RolloutPlanner<D>> rollout;
+    std::unique_ptr<HamiltonPlanner<D>> hamilton;
+    std::unique_ptr<PlayerInput> player;
+    BlindParams blind_params; // For BLIND and BLIND_REACHABILITY
+
+    explicit Controller(ControllerKind kind = ControllerKind::BLIND, const D& dims = D(), const RolloutOptions& rollout_options = RolloutOptions(),
+                        const BlindParams& blind_params = BlindParams());
+
+    Direction decide(const GameState<D>& state);
+};
+
+// Command line names: "blind", "blind-reach", "path", "rollout", "hamilton", "player". Returns false for an unknown name
+bool parse_controller_kind(const std::string& name, ControllerKind& kind);
+
+const char* controller_kind_name(ControllerKind kind);
@@ -0,0 +1,101 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "globals.h"
+
+enum class CaptureFormat : u8 {
+    PPM = 0, // One binary PPM per frame in a directory
+    PNG,     // One PNG per frame in a directory
+    RAW      // Every frame as raw RGBA8 into one file, or a named pipe read by e.g. ffmpeg -f rawvideo
+};
+
+struct CaptureOptions {
+    std::string path; // Directory for PPM and PNG, file (or named pipe) for RAW
+    CaptureFormat format = CaptureFormat::PPM;
+    u32 queue_frames = 8; // Frames waiting for the worker before new ones are dropped
+};
+
+struct CaptureStats {
+    u64 frames = 0;     // Frames handed to capture()
+    u64 written = 0;    // Frames encoded and written
+    u64 dropped = 0;    // Frames skipped because the queue was full
+    u64 failed = 0;     // Frames that could not be written
+    u32 peak_queued = 0;
+    u32 queue_capacity = 0;
+    bool async_readback = false; // Pixel buffer objects, instead of a blocking copy of the texture
+};
+
+// Offscreen frame capture. Frames are drawn into an sf::RenderTexture and read back into a ring of pixel buffer
+// objects: a readback started on one frame is only mapped PBO_COUNT - 1 frames later, when the GPU has long
+// finished it, so the render thread never waits for the GPU. The pixels go to a worker thread through a bounded
+// queue of reused frame buffers, and the worker flips, encodes and writes them. When the worker falls behind and
+// every buffer is taken, frames are dropped (and counted) instead of stalling the tick loop
+// Without pixel buffer objects (very old GL), frames are copied out of the texture with a blocking read instead
+// Works with any GL context SFML can create, including Mesa under Xvfb
+class FrameCapture {
+public:
+    // Throws std::runtime_error if the render texture or the output can not be created
+    FrameCapture(const std::string& path, CaptureFormat format, sf::Vector2u size, u32 queue_frames);
+    ~FrameCapture(); // Calls finish()
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Draw the frame in here, then call capture()
+    sf::RenderTexture& target() { return texture; }
+
+    // Finishes the frame drawn into target() and starts reading it back
+    void capture();
+
+    // Reads back the frames still in flight, writes everything queued and stops the worker. Returns the final counts
+    // From the thread that calls capture(). No capture() after this
+    CaptureStats finish();
+
+private:
+    static constexpr u32 PBO_COUNT = 3;
+
+    struct Frame {
+        u64 index;
+        bool bottom_up; // Rows from the bottom of the image up, as GL reads them
+        std::vector<u8> pixels;
+    };
+
+    void finish_readback(u32 pbo);
+    void hand_off(u64 index, bool bottom_up, const u8* pixels);
+    void write_frame(Frame& frame);
+    void run();
+
+    std::string path;
+    CaptureFormat format;
+    sf::Vector2u size;
+    usize frame_bytes;
+    sf::RenderTexture texture;
+    std::FILE* stream; // RAW only
+
+    // Readback ring. Empty without pixel buffer object support
+    std::vector<u32> pbos;
+    std::vector<u64> pbo_frame; // Frame index whose readback a PBO holds, NO_FRAME if none
+    u32 next_pbo;
+    static constexpr u64 NO_FRAME = ~u64(0);
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<Frame> queue;
+    std::vector<std::vector<u8>> free_buffers;
+    bool closing; // Set by finish()
+    CaptureStats counters;
+    std::vector<u8> scratch; // Worker only: one frame flipped and converted for the encoder
+};
+
+// Command line names: "ppm", "png", "raw". Returns false for an unknown name
+bool parse_capture_format(const std::string& name, CaptureFormat& format);
+
+const char* capture_format_name(CaptureFormat format);
@@ -0,0 +1,55 @@
+#pragma once
+#include "globals.h"
+#include "board_dims.h"
+
+// Set of the tiles the snake does not occupy
+// Dense array of the free cells plus the position of every cell in it, so insert, remove (swap with last)
+// and picking a uniformly random free cell are all O(1) no matter how full the board is
+template<typename D>
+struct FreeCells {
+    using cell_t = typename D::cell_t;
+
+    Buffer<cell_t, D::fixed_cells> cells;    // First `count` entries are the free cells, in no particular order
+    Buffer<cell_t, D::fixed_cells> position; // Index of each cell in `cells`
+    u32 count;
+    u32 capacity;
+
+    explicit FreeCells(const D& dims = D()) : count(0), capacity(dims.cells) {
+        cells.resize(dims.cells);
+        position.resize(dims.cells);
+    }
+
+    // Marks every cell as free
+    void fill() {
+        for (u32 i = 0; i < capacity; ++i) {
+            cells[i] = static_cast<cell_t>(i);
+            position[i] = static_cast<cell_t>(i);
+        }
+        count = capacity;
+    }
+
+    bool contains(u32 cell) const {
+        return position[cell] < count;
+    }
+
+    // Cell must currently be free
+    void remove(u32 cell) {
+        cell_t last = cells[--count];
+        cell_t pos = position[cell];
+        cells[pos] = last;
+        position[last] = pos;
+        cells[count] = static_cast<cell_t>(cell);
+        position[cell] = static_cast<cell_t>(count);
+    }
+
+    // Cell must currently be occupied
+    void insert(u32 cell) {
+        cell_t first_occupied = cells[count];
+        cell_t pos = position[cell];
+        cells[pos] = first_occupied;
+        position[first_occupied] = pos;
+        cells[count] = static_cast<cell_t>(cell);
+        position[cell] = static_cast<cell_t>(count);
+        count++;
+    }
+};
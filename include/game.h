@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+
+#include "globals.h"
+#include "bitboard.h"
+#include "board_dims.h"
+#include "free_cells.h"
+#include "ring_buffer.h"
+
+template<typename D>
+struct Snake {
+    Direction direction;
+    u8 grow_timer;
+    RingBuffer<typename D::cell_t, D::fixed_cells> body; // Packed cell indices. Tail at the front, head at the back
+
+    explicit Snake(const D& dims = D()) : direction(START_DIRECTION), grow_timer(START_GROW_TIMER), body(dims.cells) {}
+};
+
+enum class DeathCause : u8 {
+    NONE = 0,   // Still alive
+    WALL,       // Head left the board
+    SELF,       // Head ran into the body
+    BOARD_FULL, // No free tile left for the next apple. The game was won
+    STARVED     // Went too long without an apple (only enforced by headless runs, see run_headless_game)
+};
+
+// How the snake grows. The defaults are the game's own. Only the tuner (see tuner.h) plays with other rules. A
+// CompactState carries them along; the arena and lockstep batches always grow by the defaults
+struct GameRules {
+    u8 start_grow_timer = START_GROW_TIMER;
+    u16 grow_rate = GROW_RATE;
+};
+
+// Everything a single game needs. No rendering or windowing state lives here,
+// so a game can be stepped as fast as the CPU allows
+// With FixedDims all storage is inline. Big boards should live on the heap
+template<typename D>
+struct GameState {
+    D dims;
+    Bitboard<D> board;       // Set where the snake is (for collision detection)
+    FreeCells<D> free_cells; // Every tile that is clear in board (for apple placement)
+    Snake<D> snake;
+    std::array<u16, 2> apple_position;
+    u32 ticks;
+    u32 last_apple_tick; // Tick the last apple was eaten on
+    DeathCause death_cause;
+    GameRules rules; // Kept by init_game
+
+    explicit GameState(const D& dims = D())
+        : dims(dims), board(dims), free_cells(dims), snake(dims), apple_position{0, 0},
+          ticks(0), last_apple_tick(0), death_cause(DeathCause::NONE) {}
+};
+
+// Tiles that changed during a step, so a renderer only has to redraw those
+struct StepEvents {
+    bool tail_popped = false;
+    std::array<u16, 2> tail_position;
+    bool head_pushed = false;
+    std::array<u16, 2> head_position;
+    bool apple_spawned = false;
+};
+
+// Resets state to the start of a new game, including placing the first apple
+template<typename D>
+void init_game(GameState<D>& state);
+
+// Moves the snake one tile in direction. Returns false once the game is over (see state.death_cause)
+template<typename D>
+bool step(GameState<D>& state, Direction direction, StepEvents* events = nullptr);
+
+// Picks a new apple position on a tile the snake does not occupy. O(1) through state.free_cells
+template<typename D>
+void spawn_apple(GameState<D>& state);
+
+template<typename D>
+inline u32 snake_length(const GameState<D>& state) {
+    return state.snake.body.size();
+}
+
+template<typename D>
+inline std::array<u16, 2> head_position(const GameState<D>& state) {
+    return state.dims.cell_position(state.snake.body.back());
+}
+
+const char* death_cause_name(DeathCause cause);
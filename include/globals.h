@@ -6,6 +6,8 @@
 using u8 = uint8_t;
 using u16 = uint16_t;
 using u32 = uint32_t;
+using u64 = uint64_t;
+using i32 = int32_t;
 using usize = std::size_t;
 
 enum Direction {
@@ -20,12 +22,14 @@ enum Direction {
 // Window
 constexpr u16 WINDOW_WIDTH = 1600;
 constexpr u16 WINDOW_HEIGHT = 900;
-constexpr u16 UPDATES_PER_SECOND = 3;
+constexpr u16 UPDATES_PER_SECOND = 3; // Game ticks per second
+constexpr u16 FRAMES_PER_SECOND = 60; // Rendering and input, independent of the tick rate
 
 // Game Tiles
 constexpr u16 TILE_LENGTH = 30; // Should evenly divide the WINDOW_WIDTH and WINDOW_HEIGHT
 constexpr u16 SQUARE_LENGTH = 30; // For a smaller square per the tile
 
+// Default board size. --width/--height pick another one at startup (see board_dims.h)
 constexpr u16 WIDTH = WINDOW_WIDTH / TILE_LENGTH; // Number of tile columns
 constexpr u16 HEIGHT = WINDOW_HEIGHT / TILE_LENGTH; // Number of tile rows
 constexpr u16 OFFSET = (TILE_LENGTH - SQUARE_LENGTH ) / 2;
@@ -35,6 +39,5 @@ constexpr u32 START_LENGTH = 1;
 constexpr Direction START_DIRECTION = RIGHT;
 constexpr u8 START_GROW_TIMER = 2;
 constexpr u16 GROW_RATE = 3;
-constexpr std::array<u16, 2> START_COORDS[START_LENGTH] = {{WIDTH / 2, HEIGHT / 2}};
 
 // ====================================== //
@@ -0,0 +1,73 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "globals.h"
+#include "board_dims.h"
+#include "game.h"
+
+class MappedFile;
+
+// Hamiltonian cycle over a width x height board, stored as the position along the cycle of every cell
+// (cells row-major, like DimsOps::cell_index). The next cell on the cycle is the neighbor one position on
+struct HamiltonCycle {
+    u16 width;
+    u16 height;
+    u32 cells;
+    const u32* position;
+
+    // Where position points: the mapped cache file, or a table built in memory when it could not be cached
+    std::unique_ptr<MappedFile> file;
+    std::vector<u32> table;
+
+    HamiltonCycle();
+    ~HamiltonCycle();
+};
+
+// Cache files: a HamiltonCacheHeader, then the u32 position of every cell
+constexpr char HAMILTON_MAGIC[4] = {'S', 'N', 'K', 'H'};
+constexpr u16 HAMILTON_VERSION = 1;
+
+struct HamiltonCacheHeader {
+    char magic[4];
+    u16 version;
+    u16 width;
+    u16 height;
+    u16 reserved;
+    u32 cells;
+};
+static_assert(sizeof(HamiltonCacheHeader) == 16);
+
+// Fills position (width * height entries) with a cycle. False if the board has none: both sides odd, or a side
+// shorter than 2. Columns (or rows, when the width is odd) are swept back and forth, returning along one edge
+bool build_hamilton_cycle(u16 width, u16 height, u32* position);
+
+// $SNAKE_CACHE_DIR, $XDG_CACHE_HOME/snake or ~/.cache/snake, then hamilton_{W}x{H}.bin
+std::string hamilton_cache_path(u16 width, u16 height);
+
+// Maps the cache file for width x height, after building it (written to a temporary file and renamed) if it is
+// missing or does not match the board. The table is paged in as the snake moves, so even a 4096x4096 board starts
+// at once. Without a usable cache directory the table is built in memory
+// nullptr when the board has no Hamiltonian cycle
+std::shared_ptr<const HamiltonCycle> open_hamilton_cycle(u16 width, u16 height);
+
+// open_hamilton_cycle once per board size, shared by every controller in the process
+std::shared_ptr<const HamiltonCycle> load_hamilton_cycle(u16 width, u16 height);
+
+template<typename D>
+struct HamiltonPlanner {
+    D dims;
+    std::shared_ptr<const HamiltonCycle> cycle;
+
+    explicit HamiltonPlanner(const D& dims = D());
+};
+
+// Follows the cycle, which visits every tile, so the snake fills the board
+// It may take a shortcut: a move to a free neighbor further along the cycle, short of the apple and the tail.
+// Only when following the cycle from there reaches the apple with the tail past the skipped tiles and without
+// running into the tail on the way, so the body is back in one piece along the cycle before the next apple
+// spawns. Wherever that apple lands, the snake can then follow the cycle to a full board (see hamiltonctl.cpp)
+// Plays snake_decide on boards without a cycle
+template<typename D>
+Direction hamilton_decide(const HamiltonPlanner<D>& planner, const GameState<D>& state);
@@ -10,6 +10,11 @@
 #include "globals.h"
 #include "random_utils.h"
 
+// The record is read from ~/.snake_highscore on first use and then kept in memory
+// save_highscore only writes when the length beats the record, and holds improvements back for a moment so a
+// burst of them becomes one write. flush_highscore writes a held-back record now (it also runs at exit)
 void save_highscore(u32 highscore);
 
 u32 get_highscore();
+
+void flush_highscore();
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+
+#include "globals.h"
+#include "board_dims.h"
+#include "simulation.h"
+
+// Lockstep batch engine: K Blind Snake games stepped together, one tick for every lane at a time
+// The per-lane scalars live in structure-of-arrays form (one contiguous array per field), so the decision,
+// movement, bounds and apple checks are straight-line loops over lanes that the compiler vectorizes:
+// snake_decide's precedence ranking and its random tie-breaking are computed with compares and masks instead of
+// branches, and every lane has its own xorshift32 stream so random draws vectorize too.
+// The parts that touch a lane's own board and body (collision test, tail and head updates, apple placement)
+// stay a scalar loop, since they are gathers into per-lane memory.
+// A lane whose game ends is restarted in place on the next tick, so every lane keeps doing useful work.
+// The moves follow the same probabilities as snake_decide, and the starvation rule of run_headless_game applies,
+// but the random streams differ, so lane games are not the same games as scalar ones with the same seed
+template<typename D>
+struct LockstepBatch {
+    using cell_t = typename D::cell_t;
+
+    D dims;
+    u32 lanes;
+
+    // Structure of arrays, one entry per lane
+    std::vector<i32> head_x, head_y;
+    std::vector<i32> apple_x, apple_y;
+    std::vector<i32> direction;  // Direction
+    std::vector<i32> grow_timer;
+    std::vector<i32> next_x, next_y;
+    std::vector<u8> free_mask;   // Bit d set if moving in direction d from the head lands on a free tile
+    std::vector<u8> active;      // Lane is playing a game
+    std::vector<u8> status;      // This tick's move: bit 0 leaves the board, bit 1 lands on the apple
+    std::vector<u32> rng;        // xorshift32 state
+    std::vector<u32> ticks, last_apple_tick, length;
+
+    // Per-lane memory, lane i at offset i * stride
+    std::vector<u64> boards;     // Same layout as Bitboard words (padding bits set)
+    std::vector<cell_t> bodies;  // Ring of cells, tail at body_first
+    std::vector<u32> body_first;
+
+    u32 active_count;
+    u64 games_started;
+    u64 games_limit;                  // No new games once this many have started
+    std::vector<GameSummary> results; // Finished games, in the order they ended
+
+    // Starts a game in every lane (up to games_limit). Lane i's stream is seeded from derive_seed(seed, i)
+    LockstepBatch(u32 lanes, u64 seed, u64 games_limit = ~u64(0), const D& dims = D());
+
+    // One tick in every active lane. Finished games go to results and their lanes start new games
+    void tick();
+
+private:
+    void start_game(u32 lane);
+    void spawn_apple(u32 lane);
+    void finish(u32 lane, DeathCause cause);
+};
+
+// Plays `games` Blind Snake games on lockstep batches of `lanes` lanes, one batch per worker thread
+// Games are split evenly between the threads, so results depend on the thread count (unlike run_batch)
+std::vector<GameSummary> run_lockstep_batch(u32 games, u32 threads, u32 lanes, u64 master_seed, u16 width = WIDTH, u16 height = HEIGHT);
@@ -0,0 +1,29 @@
+#pragma once
+#include "globals.h"
+#include "bitboard.h"
+#include "board_dims.h"
+#include "game.h"
+
+// Scratch space for pathfinder_decide
+// Allocated once and reused for every decision, so deciding never touches the heap
+// Visited marks use a generation stamp, so nothing has to be cleared between searches
+template<typename D>
+struct Pathfinder {
+    using cell_t = typename D::cell_t;
+
+    D dims;
+    Buffer<cell_t, D::fixed_cells> queue;
+    Buffer<cell_t, D::fixed_cells> parent;
+    Buffer<u32, D::fixed_cells> visited; // == stamp when visited in the current search
+    u32 stamp;
+    Buffer<cell_t, D::fixed_cells> path; // Head (exclusive) to target (inclusive) of the last path found
+    Bitboard<D> virtual_board;           // Board after following a path, for the safety check
+
+    explicit Pathfinder(const D& dims = D());
+};
+
+// Shortest-path snake
+// Takes the shortest path (BFS) to the apple, but only if the tail is still reachable once the snake has
+// followed it. Otherwise chases its own tail to buy time, and falls back to snake_decide when boxed in
+template<typename D>
+Direction pathfinder_decide(Pathfinder<D>& pathfinder, const GameState<D>& state);
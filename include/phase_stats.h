@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <ostream>
+
+#include "globals.h"
+
+// Per-phase tick timers, for --stats
+// Only compiled in when the build defines SNAKE_PHASE_STATS (cmake -DSNAKE_PHASE_STATS=ON). Otherwise
+// SNAKE_TIME_PHASE expands to nothing and no timer code is left on the hot path
+
+// Phases of a tick and a frame. Nested phases are also counted in the phase around them
+// (SPAWN_APPLE is part of STEP)
+enum class Phase : u8 {
+    EVENT_POLL = 0, // window.pollEvent loop
+    DECIDE,         // Controller::decide
+    STEP,           // step: collision, tail and head updates
+    SPAWN_APPLE,    // spawn_apple
+    RENDER_UPDATE,  // Renderer tile updates and the per-frame upload
+    DRAW,           // window.clear and the board draw call
+    DISPLAY,        // window.display (includes the frame limiter's sleep)
+    CAPTURE,        // --capture: drawing the offscreen frame and starting its readback
+    COUNT
+};
+
+const char* phase_name(Phase phase);
+
+// Latency histogram with logarithmic buckets: every power of two is split into SUB_BUCKETS linear steps,
+// so any sample is within 25% of its bucket's lower bound, from 1 ns up to the full u64 range
+struct LatencyHistogram {
+    static constexpr u32 SUB_BUCKETS = 4;
+    static constexpr u32 BUCKETS = (64 - 1) * SUB_BUCKETS;
+
+    std::array<u64, BUCKETS> counts{};
+    u64 count = 0;
+    u64 sum_ns = 0;
+    u64 max_ns = 0;
+
+    void record(u64 ns);
+
+    // Adds other's samples to these
+    void merge(const LatencyHistogram& other);
+
+    // Smallest value that lands in bucket i
+    static u64 bucket_lower_bound(u32 i);
+
+    // Lower bound of the bucket holding the p (0 to 1) percentile sample
+    u64 percentile(double p) const;
+};
+
+// One histogram per phase. Each thread records into its own set, so workers never share one
+struct PhaseStats {
+    void merge(const PhaseStats& other);
+
+    std::array<LatencyHistogram, static_cast<usize>(Phase::COUNT)> phases;
+
+    LatencyHistogram& operator[](Phase phase) { return phases[static_cast<usize>(phase)]; }
+    const LatencyHistogram& operator[](Phase phase) const { return phases[static_cast<usize>(phase)]; }
+};
+
+// The calling thread's histograms
+PhaseStats& thread_phase_stats();
+
+// Every thread's histograms added up, including threads that have exited (pool workers, rollout threads)
+// Only while no thread records, e.g. after the pools have finished their work
+PhaseStats merged_phase_stats();
+
+// Summary (count, mean, p50, p90, p99, max) and non-empty buckets of every phase
+void write_phase_stats_json(std::ostream& out, const PhaseStats& stats);
+
+// One row per non-empty bucket: phase,lower_ns,upper_ns,count
+void write_phase_stats_csv(std::ostream& out, const PhaseStats& stats);
+
+// Records the time from construction to destruction into the calling thread's histogram for a phase
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+
+    ~PhaseTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        thread_phase_stats()[phase].record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define SNAKE_PHASE_CONCAT_INNER(a, b) a##b
+#define SNAKE_PHASE_CONCAT(a, b) SNAKE_PHASE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope as phase
+// SNAKE_PHASE_STATS_THREAD_START sets up the calling thread's histograms, so that does not happen inside the
+// first timed phase. Thread starts and init_game call it
+#ifdef SNAKE_PHASE_STATS
+#define SNAKE_TIME_PHASE(phase) PhaseTimer SNAKE_PHASE_CONCAT(phase_timer_, __LINE__)(phase)
+#define SNAKE_PHASE_STATS_THREAD_START() ((void)thread_phase_stats())
+#else
+#define SNAKE_TIME_PHASE(phase) ((void)0)
+#define SNAKE_PHASE_STATS_THREAD_START() ((void)0)
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "globals.h"
+#include "game.h"
+
+// Now on std::chrono::steady_clock, in nanoseconds
+inline u64 steady_now_ns() {
+    return static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// A direction key press and when it arrived (steady_now_ns)
+struct DirectionPress {
+    Direction direction;
+    u64 pressed_ns;
+};
+
+// Single-producer single-consumer ring of presses. Lock-free: the producer only moves tail and the consumer
+// only moves head, each publishing the slots it hands over with a release store
+class PressQueue {
+public:
+    static constexpr u32 CAPACITY = 16; // A power of two, so positions wrap with a mask
+
+    // Producer. False when the ring is full
+    bool push(const DirectionPress& press);
+
+    // Consumer. False when the ring is empty
+    bool pop(DirectionPress& press);
+
+private:
+    std::array<DirectionPress, CAPACITY> slots;
+    // Free-running positions. On separate cache lines, so the two sides never share one
+    alignas(64) std::atomic<u32> head{0};
+    alignas(64) std::atomic<u32> tail{0};
+};
+
+struct PlayerInputStats {
+    u64 presses = 0;  // Direction keys pressed
+    u64 rejected = 0; // Reversals of (or repeats of) the direction the snake will be heading in by then
+    u64 dropped = 0;  // Arrived with the ring full
+    u64 applied = 0;  // Turned the snake
+    u64 discarded = 0; // Still queued when the game ended
+    std::vector<double> latency_us; // Press to the tick that moved the snake that way, per applied press
+};
+
+// Buffered keyboard control for human play
+// The window pushes every direction key press as it arrives, and every tick takes the oldest one, so a burst of
+// turns between two ticks is played out over the next ticks in order instead of only the key held at tick time
+// counting. A press that reverses (or repeats) the direction the snake will have after the presses queued before
+// it is rejected at once, so it never takes up a tick. Without a press queued, the snake keeps going
+// press and reset are the producer side, decide the consumer side (see PressQueue)
+class PlayerInput {
+public:
+    void press(Direction direction, u64 pressed_ns);
+
+    // Between games, while neither side runs. Drops (and counts) the presses still queued
+    void reset();
+
+    template<typename D>
+    Direction decide(const GameState<D>& state);
+
+    // While neither side runs
+    const PlayerInputStats& stats() const { return counters; }
+
+private:
+    PressQueue queue;
+    Direction last_queued = START_DIRECTION; // Producer only: where the snake heads once the queue is played out
+    PlayerInputStats counters;
+};
+
+// UP/DOWN and LEFT/RIGHT differ only in the lowest bit
+inline bool is_reversal(Direction a, Direction b) {
+    return (a ^ b) == 1;
+}
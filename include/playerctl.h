@@ -0,0 +1,9 @@
+#pragma once
+#include <optional>
+#include <SFML/Graphics.hpp>
+
+#include "globals.h"
+
+// The direction a key turns the snake in: W/K down, S/J up, D/L right, A/H left, and the arrow keys. y grows down
+// the screen, so the keys pointing up move toward lower y (DOWN). Nothing for any other key
+std::optional<Direction> key_direction(sf::Keyboard::Key key);
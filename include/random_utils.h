@@ -1,13 +1,100 @@
 #pragma once
+#include <array>
 #include <random>
 
-extern std::mt19937& get_rng();
+#include "globals.h"
+
+// xoshiro256** (Blackman and Vigna): 32 bytes of state, a handful of instructions per 64-bit draw, and a
+// 2^256 - 1 period. Meets UniformRandomBitGenerator, so it also works with the std distributions
+struct Xoshiro256 {
+    using result_type = u64;
+
+    std::array<u64, 4> s;
+
+    explicit Xoshiro256(u64 seed_value = 0) { seed(seed_value); }
+
+    // Expands seed into the full state with SplitMix64, so similar seeds still give unrelated streams
+    void seed(u64 seed_value) {
+        for (u64& word : s) {
+            seed_value += 0x9E3779B97F4A7C15ull;
+            u64 z = seed_value;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    static constexpr u64 min() { return 0; }
+    static constexpr u64 max() { return ~u64(0); }
+
+    u64 operator()() {
+        const u64 result = rotl(s[1] * 5, 7) * 9;
+        const u64 t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+private:
+    static u64 rotl(u64 x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// Each thread has its own generator, so games running on different worker threads
+// never share (or contend on) RNG state
+extern Xoshiro256& get_rng();
+
+// Fixed at compile time, for the highscore key. Must stay a std::mt19937 with a std distribution,
+// or existing highscore files could no longer be read
 extern std::mt19937& get_rng_seeded();
 
+// Reseeds the calling thread's generator (see get_rng), making everything it draws afterwards reproducible
+void seed_rng(u64 seed);
+
+// Derives an independent seed for stream number `stream` from a master seed (SplitMix64)
+u64 derive_seed(u64 master_seed, u64 stream);
+
+// Uniform integer in [0, range) without modulo bias (Lemire's multiply-shift with rejection)
+// The rejection test only runs for the rare low products, so a draw almost never needs a division
+inline u32 random_below(Xoshiro256& rng, u32 range) {
+    u64 m = u64(static_cast<u32>(rng() >> 32)) * range;
+    u32 low = static_cast<u32>(m);
+    if (low < range) {
+        const u32 threshold = (0u - range) % range;
+        while (low < threshold) {
+            m = u64(static_cast<u32>(rng() >> 32)) * range;
+            low = static_cast<u32>(m);
+        }
+    }
+    return static_cast<u32>(m >> 32);
+}
+
+inline u64 random_below(Xoshiro256& rng, u64 range) {
+    unsigned __int128 m = static_cast<unsigned __int128>(rng()) * range;
+    u64 low = static_cast<u64>(m);
+    if (low < range) {
+        const u64 threshold = (0 - range) % range;
+        while (low < threshold) {
+            m = static_cast<unsigned __int128>(rng()) * range;
+            low = static_cast<u64>(m);
+        }
+    }
+    return static_cast<u64>(m >> 64);
+}
+
+// Uniform integer in [min, max], from the calling thread's generator
 template<typename T>
 T random_int(T min, T max) {
-    std::uniform_int_distribution<T> dist(min, max);
-    return dist(get_rng());
+    // Works for signed T too: the difference is taken modulo 2^64
+    const u64 span = static_cast<u64>(max) - static_cast<u64>(min);
+    if (span < 0xFFFFFFFFull)
+        return static_cast<T>(static_cast<u64>(min) + random_below(get_rng(), static_cast<u32>(span + 1)));
+    if (span == ~u64(0))
+        return static_cast<T>(get_rng()());
+    return static_cast<T>(static_cast<u64>(min) + random_below(get_rng(), span + 1));
 }
 
 template<typename T>
@@ -15,4 +102,3 @@ T random_int_compile_time_seeded(T min, T max) {
     std::uniform_int_distribution<T> dist(min, max);
     return dist(get_rng_seeded());
 }
-
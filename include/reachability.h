@@ -0,0 +1,64 @@
+#pragma once
+#include "globals.h"
+#include "bitboard.h"
+#include "board_dims.h"
+#include "game.h"
+
+// Connected regions of free tiles, kept up to date one tile change at a time
+// A tick changes at most two tiles (tail freed, head occupied), so instead of flood filling the board
+// for every decision this only touches what those changes can affect:
+// - Freeing a tile merges the regions around it, relabeling the smaller ones into the largest
+// - Occupying a tile can split its region. If the free tiles around it stay connected through the
+//   8 tiles surrounding it nothing happens, otherwise the pieces are searched in lockstep and all but
+//   the last piece still growing get new labels, so the cost is bounded by the smaller pieces
+template<typename D>
+struct Reachability {
+    using cell_t = typename D::cell_t;
+    static constexpr cell_t OCCUPIED = static_cast<cell_t>(~cell_t(0));
+
+    D dims;
+    Buffer<cell_t, D::fixed_cells> label;      // Region id of every free tile, OCCUPIED for snake tiles
+    Buffer<u32, D::fixed_cells> region_size;   // Free tiles in each region, indexed by region id
+    Buffer<cell_t, D::fixed_cells> unused_ids; // Stack of region ids not in use
+    u32 unused_count;
+
+    // Scratch for splits: up to four lockstep searches, one per free neighbor
+    Buffer<cell_t, D::fixed_cells> queues[4];
+    Buffer<u32, D::fixed_cells> visited; // == stamp * 4 + search index when visited in the current split check
+    u32 stamp;
+
+    // Snapshot of the game this was last synced with (see sync)
+    u32 synced_ticks;
+    u32 synced_head;
+    u32 synced_tail;
+    bool synced;
+
+    explicit Reachability(const D& dims = D());
+
+    // Labels every region of board from scratch. O(board)
+    void rebuild(const Bitboard<D>& board);
+
+    // Cell was occupied and is now free (the tail moved off it)
+    void free_cell(u32 cell);
+
+    // Cell was free and is now occupied (the head moved onto it)
+    void occupy_cell(u32 cell);
+
+    // Brings the regions up to date with state: applies the last tick's tail and head moves when state
+    // is exactly one tick past the last sync, and rebuilds otherwise (new game, skipped ticks)
+    void sync(const GameState<D>& state);
+
+    bool is_free(u32 cell) const { return label[cell] != OCCUPIED; }
+
+    // Free tiles in the region of a free cell
+    u32 size_of(u32 cell) const { return region_size[label[cell]]; }
+
+    // Free tiles the head can reach after moving one step in dir, including the tile it lands on
+    // 0 if that tile is occupied or off the board. O(1)
+    u32 reachable_after_move(u32 head, Direction dir) const;
+
+private:
+    cell_t new_region();
+    u32 relabel(u32 start, cell_t id);
+    bool locally_connected(u32 cell) const;
+};
@@ -0,0 +1,209 @@
+#pragma once
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "globals.h"
+#include "board_dims.h"
+#include "controller.h"
+#include "game.h"
+
+// Replay files
+// A file is a sequence of game records. Each record is a ReplayHeader followed by chunks of
+//   u32 ticks, u32 apples, moves (2 bits per tick, 4 per byte, first tick in the low bits), apples (u32 cell each)
+// The apples are every apple the game spawned in order, starting with the one init_game placed. Together with
+// the moves that is enough to play a game back without the controller or the RNG. The seed and controller kind
+// are kept too, so a game can also be re-simulated from scratch and checked against its own recording.
+// All values are little-endian
+
+constexpr char REPLAY_MAGIC[4] = {'S', 'N', 'K', 'R'};
+constexpr u16 REPLAY_VERSION = 1;
+
+struct ReplayHeader {
+    char magic[4];
+    u16 version;
+    u16 width;
+    u16 height;
+    u8 controller_kind; // ControllerKind
+    u8 death_cause;     // DeathCause
+    u32 tick_rate;      // Ticks per second when recorded, 0 if recorded headless
+    u64 seed;           // What seed_rng was given right before init_game
+    u32 final_length;
+    u32 ticks;
+    u64 apples;
+    u64 record_bytes;   // Size of the whole record, header included
+};
+static_assert(sizeof(ReplayHeader) == 48, "ReplayHeader is written to disk as is");
+
+// Appends to a file from a background thread, so whoever produces the data never waits on disk I/O
+// Buffers handed to write() come back through take_buffer() once written, so steady-state writing allocates nothing
+class BufferedFileWriter {
+public:
+    explicit BufferedFileWriter(const std::string& path);
+    ~BufferedFileWriter(); // close(), without reporting a failed write. Call close() to learn about one
+
+    // Writes everything still queued, then closes the file. Only the first call does anything
+    // Throws std::runtime_error if any write failed, which leaves the file incomplete
+    void close();
+
+    // Whether a write has failed so far. Everything queued after a failure is dropped
+    bool failed();
+
+    // An empty buffer to fill and pass to write()
+    std::vector<u8> take_buffer();
+
+    // Queues bytes to be appended to the file
+    void write(std::vector<u8>&& bytes);
+
+    // Queues bytes to overwrite the file at offset (which must already have been written)
+    void write_at(u64 offset, std::vector<u8>&& bytes);
+
+private:
+    struct Block {
+        u64 offset; // APPEND for the end of the file
+        std::vector<u8> bytes;
+    };
+    static constexpr u64 APPEND = ~u64(0);
+
+    void run();
+
+    std::string path;
+    std::FILE* file;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable work_available;
+    std::deque<Block> queue;
+    std::vector<std::vector<u8>> free_buffers;
+    bool closing;
+    bool write_failed;
+};
+
+// Records games into a replay file
+// Moves are packed into the current chunk on the calling thread, which costs a few bit operations per tick.
+// Full chunks and the finished header go to a BufferedFileWriter
+class ReplayRecorder {
+public:
+    explicit ReplayRecorder(const std::string& path);
+
+    // Starts a game record. seed is what seed_rng was given before init_game. Record the first apple next
+    void begin_game(u16 width, u16 height, ControllerKind controller_kind, u64 seed, u32 tick_rate);
+
+    void record_move(Direction direction) {
+        if (chunk_ticks % 4 == 0)
+            moves.push_back(0);
+        moves.back() |= static_cast<u8>(direction) << (2 * (chunk_ticks % 4));
+        chunk_ticks++;
+        header.ticks++;
+        if (chunk_ticks == CHUNK_TICKS)
+            flush_chunk();
+    }
+
+    // Apple placed on cell, including the first one of the game
+    void record_apple(u32 cell) {
+        apples.push_back(cell);
+        header.apples++;
+    }
+
+    // Writes what is left of the game and fills in its header
+    // Throws std::runtime_error if a write to the file has already failed
+    void end_game(u32 final_length, DeathCause death_cause);
+
+    // Writes everything and closes the file. Throws std::runtime_error if any write failed
+    void close() { writer.close(); }
+
+private:
+    // Ticks per chunk. 4 KB of moves
+    static constexpr u32 CHUNK_TICKS = 16384;
+
+    void flush_chunk();
+
+    BufferedFileWriter writer;
+    ReplayHeader header;
+    u64 header_offset; // Where the current game's header is in the file
+    u64 file_size;     // Bytes handed to the writer so far
+    u32 chunk_ticks;
+    std::vector<u8> moves;
+    std::vector<u32> apples;
+};
+
+// Read-only memory map of a whole file, so large replays are paged in as they are read instead of loaded up front
+// sequential tells the kernel to read ahead (replays), otherwise pages are read as they are touched
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path, bool sequential = true); // Throws std::runtime_error if the file can not be mapped
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const u8* data() const { return bytes; }
+    usize size() const { return length; }
+
+private:
+    const u8* bytes;
+    usize length;
+};
+
+// One game record inside a mapped replay file
+struct ReplayGame {
+    ReplayHeader header;
+    const u8* chunks;   // First chunk
+    usize chunks_size;
+};
+
+// Every game record in file. Throws std::runtime_error if the file is not a valid replay
+std::vector<ReplayGame> read_replay_games(const MappedFile& file);
+
+// Reads the moves and apples of a game in order
+// Moves and apples are read through separate walks over the chunks, so neither depends on which chunk
+// the recorder happened to put an apple in
+class ReplayCursor {
+public:
+    explicit ReplayCursor(const ReplayGame& game);
+
+    // False when there are no more moves
+    bool next_move(Direction& direction);
+
+    // False when there are no more apples
+    bool next_apple(u32& cell);
+
+private:
+    struct ChunkWalk {
+        const u8* next_chunk;
+        const u8* moves;  // Current chunk's moves
+        const u8* apples; // Current chunk's apples
+        u32 ticks;        // In the current chunk
+        u32 apple_count;  // In the current chunk
+        u32 index;        // Next move or apple in the current chunk
+
+        // Moves on to the next chunk. False at the end of the game
+        bool advance(const u8* end);
+    };
+
+    const u8* end;
+    ChunkWalk move_walk;
+    ChunkWalk apple_walk;
+};
+
+// Playback: the game's own moves and apples, no controller or RNG involved
+// start_playback resets state to the recorded game's first tick. playback_step then plays one recorded tick and
+// returns false once the game has ended (the snake died or the moves ran out)
+template<typename D>
+void start_playback(GameState<D>& state, ReplayCursor& cursor);
+
+template<typename D>
+bool playback_step(GameState<D>& state, ReplayCursor& cursor, StepEvents* events = nullptr);
+
+struct ReplayVerification {
+    bool matches;
+    u64 ticks;           // Ticks re-simulated
+    std::string problem; // What differed first, if anything
+};
+
+// Re-simulates a recorded game from its seed with its controller at full speed, and checks every move, every apple
+// and the final result against the recording
+ReplayVerification verify_replay(const ReplayGame& game);
@@ -0,0 +1,53 @@
+#pragma once
+#include "globals.h"
+#include "board_dims.h"
+
+// Fixed-capacity FIFO with O(1) push at the back and pop at the front
+// With a compile-time CAPACITY the storage is inline, so copying it is a memcpy. With CAPACITY 0 the
+// capacity is set once by the constructor. Either way pushing and popping never allocate
+template<typename T, u32 CAPACITY>
+struct RingBuffer {
+    Buffer<T, CAPACITY> items;
+    u32 capacity;
+    u32 first; // Index of the front element
+    u32 count;
+
+    explicit RingBuffer(u32 runtime_capacity = CAPACITY)
+        : capacity(CAPACITY != 0 ? CAPACITY : runtime_capacity), first(0), count(0) {
+        items.resize(capacity);
+    }
+
+    void clear() {
+        first = 0;
+        count = 0;
+    }
+
+    u32 size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == capacity; }
+
+    // Must not be full
+    void push_back(T value) {
+        items[wrap(first + count)] = value;
+        count++;
+    }
+
+    // Must not be empty
+    void pop_front() {
+        first = wrap(first + 1);
+        count--;
+    }
+
+    T front() const { return items[first]; }
+    T back() const { return items[wrap(first + count - 1)]; }
+
+    // i = 0 is the front
+    T operator[](u32 i) const { return items[wrap(first + i)]; }
+
+private:
+    // Indices never exceed 2 * capacity, so a compare and subtract replaces the modulo
+    u32 wrap(u32 i) const {
+        const u32 cap = CAPACITY != 0 ? CAPACITY : capacity;
+        return i >= cap ? i - cap : i;
+    }
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "globals.h"
+#include "board_dims.h"
+#include "compact_state.h"
+#include "game.h"
+#include "thread_pool.h"
+
+struct RolloutOptions {
+    u32 threads = 1;        // Rollout workers. 1 runs them on the calling thread
+    u32 budget_us = 2000;   // Time per decision. Rollouts still running at the deadline are the last ones
+    u32 depth = 64;         // Ticks simulated per rollout
+};
+
+// Running totals of one rollout worker. Aligned so workers never share a cache line
+struct alignas(64) RolloutTally {
+    double score[4];   // Indexed by Direction
+    u32 count[4];
+    u64 rollouts;
+};
+
+// Monte Carlo controller
+// Tries every move that leads onto a free tile. For each, many rollouts step a CompactState fork forward
+// with the Blind Snake (snake_decide) choosing every later move, and score how long the snake survives and how
+// many apples it eats. The move with the best mean score wins. Rollouts are spread over a thread pool and
+// stop at a per-decision deadline, so the decision always takes about options.budget_us however many
+// rollouts that turns out to be
+// Rollouts draw from their own seeded streams, so they never disturb the RNG of the game being played.
+// How many rollouts finish depends on timing, so games played with this controller are not reproducible
+template<typename D>
+struct RolloutPlanner {
+    D dims;
+    RolloutOptions options;
+    std::unique_ptr<ThreadPool> pool;                     // Only with more than one thread
+    std::vector<std::unique_ptr<CompactState<D>>> scratch; // One fork per worker
+    std::vector<RolloutTally> tallies;                    // One per worker
+    std::unique_ptr<CompactState<D>> root;
+    u64 seed;      // Rollout streams of decision i are derived from seed and i
+    u64 decisions;
+
+    // Totals over every decision, for reporting rollouts per second
+    u64 rollouts;
+    double busy_seconds;
+
+    explicit RolloutPlanner(const RolloutOptions& options, const D& dims = D());
+};
+
+template<typename D>
+Direction rollout_decide(RolloutPlanner<D>& planner, const GameState<D>& state);
@@ -0,0 +1,25 @@
+#pragma once
+#include "globals.h"
+#include "board_dims.h"
+#include "game.h"
+#include "controller.h"
+#include "replay.h"
+
+struct GameSummary {
+    u32 length;
+    u32 ticks;
+    DeathCause death_cause;
+};
+
+// A controller that goes this many ticks without an apple is assumed to be stuck in a loop
+// Generous enough for a snake that has to walk the whole board for every apple
+template<typename D>
+u32 starvation_ticks(const D& dims) {
+    return 4 * dims.cells;
+}
+
+// Plays one full game with controller as fast as possible (no window, no frame limiter)
+// Ends the game as STARVED after starvation_ticks without an apple, so it always finishes
+// With a recorder, every apple and move goes into the game record the caller began (see ReplayRecorder)
+template<typename D>
+GameSummary run_headless_game(GameState<D>& state, Controller<D>& controller, ReplayRecorder* recorder = nullptr);
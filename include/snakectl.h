@@ -1,10 +1,34 @@
 #pragma once
 #include <array>
-#include <SFML/Graphics.hpp>
+#include <optional>
+#include <string>
 
 #include "globals.h"
+#include "bitboard.h"
+#include "reachability.h"
 #include "random_utils.h"
 
-Direction player_decide(Direction current_direction);
+// Tuning knobs of the Blind Snake. The defaults are the values it was hand-tuned with
+// Every move gets a precedence from 0 to MAX_PRECEDENCE and the snake picks among the highest. Moves toward the
+// apple always get MAX_PRECEDENCE and blocked moves 0; the levels of the other kinds of move are tunable (1 to 3)
+struct BlindParams {
+    static constexpr u8 MAX_PRECEDENCE = 3;
 
-Direction snake_decide(std::array<u16, 2> apple_position, std::array<u16, 2> current_head_position, Direction current_direction, u8 tiles[HEIGHT][WIDTH]);
+    u8 laziness = 2;           // Among moves of equal precedence, keeps the current direction with odds laziness : 1
+    u16 keep_chance = 128;     // Out of 256: chance to keep going when the current direction leads toward the apple
+    u8 neutral_precedence = 2; // Moves that neither close in on the apple nor leave the row or column it is on
+    u8 aligned_precedence = 1; // Moves off the row or column the apple is on
+    u8 pocket_precedence = 1;  // Moves into a smaller region than another move offers (with reachability only)
+};
+
+// "laziness=2,keep=128,neutral=2,aligned=1,pocket=1", the format of format_blind_params. Keys may be left out
+// (they keep their value in params) and come in any order. Returns false for an unknown key or a value out of range
+bool parse_blind_params(const std::string& text, BlindParams& params);
+
+std::string format_blind_params(const BlindParams& params);
+
+// reachability is optional. When given (and synced with the board) the snake also avoids moves into a pocket
+// smaller than the largest region it could move into instead
+template<typename D>
+Direction snake_decide(std::array<u16, 2> apple_position, std::array<u16, 2> current_head_position, Direction current_direction, const Bitboard<D>& board,
+                       const Reachability<D>* reachability = nullptr, const BlindParams& params = BlindParams());
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "globals.h"
+
+// Work-stealing thread pool
+// Every worker owns a task queue. It pops its own newest task first, and when that runs dry
+// it steals the oldest task from another worker, so uneven tasks (long vs short games) balance out
+class ThreadPool {
+public:
+    explicit ThreadPool(u32 thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queues a task. From a worker thread it goes to that worker's own queue, otherwise round-robin
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished
+    void wait();
+
+    u32 size() const { return static_cast<u32>(threads.size()); }
+
+    // Index of the calling worker thread in its pool, or -1 when not called from a pool worker
+    static int worker_index();
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void worker_loop(u32 index);
+    bool try_pop(u32 index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex state_mutex;
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    std::atomic<u64> queued{0};  // Submitted but not yet picked up
+    std::atomic<u64> pending{0}; // Submitted but not yet finished
+    std::atomic<u32> next_queue{0};
+    bool stopping = false;
+};
+
+// Default worker count: one per hardware thread
+u32 default_thread_count();
@@ -0,0 +1,34 @@
+#pragma once
+#include "globals.h"
+
+// Shared by the board renderers (board_vertices.h, board_texture.h)
+
+// What is drawn on a tile
+enum class Tile : u8 {
+    EMPTY = 0,
+    SNAKE,
+    APPLE
+};
+
+// Where the tiles of a board go on screen. TILE_LENGTH for the default board, scaled to fit the window otherwise
+struct TileLayout {
+    u16 width;  // Board size in tiles
+    u16 height;
+    float tile_length;
+    float square_length;
+    float offset;
+};
+
+TileLayout make_tile_layout(u16 width, u16 height);
+
+// GPU uploads (buffer or texture update calls) and the bytes they sent
+struct UploadCounters {
+    u64 calls;
+    u64 bytes;
+
+    UploadCounters& operator+=(const UploadCounters& other) {
+        calls += other.calls;
+        bytes += other.bytes;
+        return *this;
+    }
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "globals.h"
+#include "controller.h"
+#include "game.h"
+#include "snakectl.h"
+
+// Tuner mode: searches the Blind Snake's BlindParams (and optionally the growth rules) for the configuration whose
+// windowless games end with the longest snake on one board size
+// Every candidate plays the same seeded games (game i is seeded from the tuner seed and i), so two candidates are
+// compared game by game and luck cancels out. Games run in stages spread over a thread pool. After each stage a
+// candidate is dropped when it is clearly worse than the best one so far: its mean per-game difference to the
+// best is more than stop_sigmas standard errors below zero. Most candidates are settled after a stage or two
+
+enum class TuneSearch : u8 {
+    GRID = 0, // Every combination of a fixed set of values per knob
+    EVOLVE    // Generations of mutated and recombined survivors, starting from the defaults
+};
+
+struct TuneOptions {
+    TuneSearch search = TuneSearch::GRID;
+    ControllerKind controller = ControllerKind::BLIND; // BLIND or BLIND_REACHABILITY
+    bool rules = false;      // Also search start_grow_timer and grow_rate
+    u32 games = 2000;        // Games per candidate that is not stopped early
+    u32 stages = 8;          // The games are played in this many stages, with an early stopping check after each
+    double stop_sigmas = 3;  // 0 turns early stopping off
+    u32 generations = 20;    // EVOLVE
+    u32 population = 32;     // EVOLVE
+    u32 threads = 1;
+    u64 seed = 0;
+};
+
+struct TuneCandidate {
+    BlindParams blind;
+    GameRules rules;
+};
+
+// Final lengths of the games a candidate played
+struct TuneScore {
+    u32 games = 0;
+    double mean = 0;
+    double stddev = 0;
+    u32 min = 0;
+    u32 p10 = 0;
+    u32 median = 0;
+    u32 p90 = 0;
+    u32 max = 0;
+    u32 board_full = 0;        // Games won
+    bool stopped_early = false;
+};
+
+struct TuneResult {
+    TuneCandidate best;
+    TuneScore best_score;
+    TuneScore default_score; // The defaults always go first, so the best is never worse than them
+    u32 candidates = 0;
+    u32 stopped_early = 0;
+    u64 games = 0;
+    double seconds = 0;
+};
+
+// Called after every candidate, from the thread that called run_tuner. evaluated counts from 1
+using TuneProgress = std::function<void(u32 evaluated, const TuneCandidate& candidate, const TuneScore& score, bool new_best)>;
+
+// Throws std::runtime_error for a controller other than BLIND or BLIND_REACHABILITY
+TuneResult run_tuner(u16 width, u16 height, const TuneOptions& options, const TuneProgress& progress = nullptr);
+
+// "start_grow=2,grow_rate=3", in the style of format_blind_params
+std::string format_game_rules(const GameRules& rules);
+
+// Command line names: "grid", "evolve". Returns false for an unknown name
+bool parse_tune_search(const std::string& name, TuneSearch& search);
+
+const char* tune_search_name(TuneSearch search);
@@ -0,0 +1,127 @@
+#include <algorithm>
+
+#include "board_renderer.h"
+
+TileLayout make_tile_layout(u16 width, u16 height) {
+    TileLayout layout;
+    layout.width = width;
+    layout.height = height;
+    layout.tile_length = std::min(float(WINDOW_WIDTH) / width, float(WINDOW_HEIGHT) / height);
+    layout.square_length = layout.tile_length * SQUARE_LENGTH / TILE_LENGTH;
+    layout.offset = (layout.tile_length - layout.square_length) / 2;
+    return layout;
+}
+
+BoardRenderer::BoardRenderer(RendererKind kind, const TileLayout& layout)
+    : kind(kind), fading{}, interpolated(false), total{0, 0}, frames(0), tile_changes(0) {
+    if (kind == RendererKind::TEXTURE)
+        texture = std::make_unique<BoardTexture>(layout);
+    else
+        vertices = std::make_unique<BoardVertices>(layout);
+}
+
+template<typename D>
+void BoardRenderer::reset(const GameState<D>& state) {
+    if (interpolated && kind == RendererKind::TEXTURE)
+        texture->set_fade({-1, -1}, {-1, -1}, 1);
+    interpolated = false;
+    if (kind == RendererKind::TEXTURE)
+        total += texture->reset(state.board);
+    else
+        total += vertices->reset(state.board);
+    set_tile(state.apple_position[0], state.apple_position[1], Tile::APPLE);
+}
+
+void BoardRenderer::set_tile(u16 x, u16 y, Tile tile) {
+    tile_changes++;
+    if (kind == RendererKind::TEXTURE)
+        texture->set_tile(x, y, tile);
+    else
+        vertices->set_tile(x, y, tile);
+}
+
+void BoardRenderer::apply_step(const StepEvents& events, std::array<u16, 2> apple_position) {
+    if (interpolated)
+        settle(apple_position);
+    fading = events;
+
+    if (events.tail_popped)
+        set_tile(events.tail_position[0], events.tail_position[1], Tile::EMPTY);
+    if (events.head_pushed)
+        set_tile(events.head_position[0], events.head_position[1], Tile::SNAKE);
+    if (events.apple_spawned)
+        set_tile(apple_position[0], apple_position[1], Tile::APPLE);
+}
+
+void BoardRenderer::interpolate(float alpha, std::array<u16, 2> apple_position) {
+    interpolated = true;
+    // An apple that spawned where the tail just left is drawn as is
+    bool fade_head = fading.head_pushed;
+    bool fade_tail = fading.tail_popped && fading.tail_position != apple_position;
+
+    if (kind == RendererKind::TEXTURE) {
+        sf::Vector2f none(-1, -1);
+        texture->set_fade(fade_head ? sf::Vector2f(fading.head_position[0], fading.head_position[1]) : none,
+                          fade_tail ? sf::Vector2f(fading.tail_position[0], fading.tail_position[1]) : none,
+                          alpha);
+        return;
+    }
+    // White alpha of the way in, and (1 - alpha) of the way out
+    auto gray = [](float level) {
+        u8 v = static_cast<u8>(level * 255 + 0.5f);
+        return sf::Color(v, v, v);
+    };
+    if (fade_head)
+        vertices->set_color(fading.head_position[0], fading.head_position[1], gray(alpha));
+    if (fade_tail)
+        vertices->set_color(fading.tail_position[0], fading.tail_position[1], gray(1 - alpha));
+}
+
+void BoardRenderer::settle(std::array<u16, 2> apple_position) {
+    interpolated = false;
+    if (kind == RendererKind::TEXTURE) {
+        texture->set_fade({-1, -1}, {-1, -1}, 1);
+        return;
+    }
+    if (fading.head_pushed)
+        vertices->set_tile(fading.head_position[0], fading.head_position[1], Tile::SNAKE);
+    if (fading.tail_popped && fading.tail_position != apple_position)
+        vertices->set_tile(fading.tail_position[0], fading.tail_position[1], Tile::EMPTY);
+}
+
+void BoardRenderer::flush() {
+    frames++;
+    if (kind == RendererKind::TEXTURE)
+        total += texture->flush();
+    else
+        total += vertices->flush();
+}
+
+void BoardRenderer::draw(sf::RenderTarget& target) const {
+    if (kind == RendererKind::TEXTURE)
+        texture->draw(target);
+    else
+        vertices->draw(target);
+}
+
+bool parse_renderer_kind(const std::string& name, RendererKind& kind) {
+    if (name == "vertex")
+        kind = RendererKind::VERTEX;
+    else if (name == "texture")
+        kind = RendererKind::TEXTURE;
+    else
+        return false;
+    return true;
+}
+
+const char* renderer_kind_name(RendererKind kind) {
+    switch (kind) {
+        case RendererKind::VERTEX:  return "vertex";
+        case RendererKind::TEXTURE: return "texture";
+    }
+    return "unknown";
+}
+
+#define INSTANTIATE(D) \
+    template void BoardRenderer::reset(const GameState<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
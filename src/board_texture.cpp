@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "board_texture.h"
+
+// Clean rows between two dirty ranges are uploaded along with them when the gap is at most this many rows
+static constexpr u32 MERGE_GAP_ROWS = 4;
+
+// The quad's texture coordinates are board coordinates in tiles (x + 0.5 is the middle of column x), so the
+// shader only needs floor() to find the tile, and the position within it to leave the gap around each square.
+// GLSL 1.10 (what SFML targets) has no integer texel fetches or bit ops, hence the float channel selection
+static const char* FRAGMENT_SHADER = R"(
+uniform sampler2D tiles;
+uniform vec2 texture_size;    // In texels
+uniform float square_margin;  // Gap around each square, as a fraction of the tile length
+uniform vec2 fade_in;         // Tile blending from black to its color, (-1, -1) for none
+uniform vec2 fade_out;        // Tile blending from white to its color, (-1, -1) for none
+uniform float fade;           // How far along both blends are, 0 to 1
+
+void main() {
+    vec2 board_position = gl_TexCoord[0].xy;
+    vec2 tile = floor(board_position);
+    vec2 within = board_position - tile;
+
+    vec4 texel = texture2D(tiles, (vec2(floor(tile.x / 4.0), tile.y) + 0.5) / texture_size);
+    float lane = mod(tile.x, 4.0);
+    float value = lane < 0.5 ? texel.r : lane < 1.5 ? texel.g : lane < 2.5 ? texel.b : texel.a;
+    value = floor(value * 255.0 + 0.5);
+
+    vec3 color = value < 0.5 ? vec3(0.0) : value < 1.5 ? vec3(1.0) : vec3(1.0, 0.0, 0.0);
+    if (tile == fade_in)
+        color *= fade;
+    if (tile == fade_out)
+        color = mix(vec3(1.0), color, fade);
+    bool in_square = all(greaterThanEqual(within, vec2(square_margin))) &&
+                     all(lessThan(within, vec2(1.0 - square_margin)));
+    gl_FragColor = vec4(in_square ? color : vec3(0.0), 1.0);
+}
+)";
+
+BoardTexture::BoardTexture(const TileLayout& layout)
+    : layout(layout), texture_width((layout.width + 3u) / 4u) {
+    tiles.assign(usize(texture_width) * 4 * layout.height, 0);
+    dirty.reserve(layout.height);
+    dirty_flags.assign(layout.height, 0);
+
+    if (!sf::Shader::isAvailable())
+        throw(std::runtime_error("Shaders are not available, so the texture renderer can not be used"));
+    if (!shader.loadFromMemory(FRAGMENT_SHADER, sf::Shader::Type::Fragment))
+        throw(std::runtime_error("Failed to compile the board shader"));
+    if (!texture.resize({texture_width, layout.height}))
+        throw(std::runtime_error("Failed to create a " + std::to_string(texture_width) + "x" + std::to_string(layout.height) + " board texture"));
+    texture.setSmooth(false);
+
+    shader.setUniform("tiles", texture);
+    shader.setUniform("texture_size", sf::Vector2f(float(texture_width), float(layout.height)));
+    shader.setUniform("square_margin", layout.offset / layout.tile_length);
+    set_fade({-1, -1}, {-1, -1}, 1);
+
+    // Two triangles covering the board
+    float right = layout.width * layout.tile_length;
+    float bottom = layout.height * layout.tile_length;
+    sf::Vector2f corners[4] = {{0, 0}, {right, 0}, {0, bottom}, {right, bottom}};
+    sf::Vector2f board_corners[4] = {{0, 0}, {float(layout.width), 0}, {0, float(layout.height)}, {float(layout.width), float(layout.height)}};
+    const u8 order[6] = {0, 2, 3, 0, 3, 1}; // TL BL BR, TL BR TR like set_square_vertices_positions
+    for (u8 i = 0; i < 6; ++i) {
+        quad[i].position = corners[order[i]];
+        quad[i].color = sf::Color::White;
+        quad[i].texCoords = board_corners[order[i]];
+    }
+}
+
+template<typename D>
+UploadCounters BoardTexture::reset(const Bitboard<D>& board) {
+    const usize row_bytes = usize(texture_width) * 4;
+    for (u16 y = 0; y < layout.height; ++y) {
+        for (u16 x = 0; x < layout.width; ++x) {
+            tiles[y * row_bytes + x] = static_cast<u8>(board.test(x, y) ? Tile::SNAKE : Tile::EMPTY);
+        }
+    }
+    for (u32 row : dirty) {
+        dirty_flags[row] = 0;
+    }
+    dirty.clear();
+
+    texture.update(tiles.data());
+    return {1, tiles.size()};
+}
+
+void BoardTexture::set_tile(u16 x, u16 y, Tile tile) {
+    tiles[usize(y) * texture_width * 4 + x] = static_cast<u8>(tile);
+    if (!dirty_flags[y]) {
+        dirty_flags[y] = 1;
+        dirty.push_back(y);
+    }
+}
+
+UploadCounters BoardTexture::flush() {
+    UploadCounters uploads{0, 0};
+    if (dirty.empty())
+        return uploads;
+
+    std::sort(dirty.begin(), dirty.end());
+
+    // Rows [first, last) are waiting to be uploaded
+    const usize row_bytes = usize(texture_width) * 4;
+    auto upload = [this, &uploads, row_bytes](u32 first, u32 last) {
+        texture.update(&tiles[first * row_bytes], {texture_width, last - first}, {0, first});
+        uploads.calls++;
+        uploads.bytes += (last - first) * row_bytes;
+    };
+
+    u32 first = dirty[0];
+    u32 last = first + 1;
+    for (usize i = 1; i < dirty.size(); ++i) {
+        if (dirty[i] - last > MERGE_GAP_ROWS) {
+            upload(first, last);
+            first = dirty[i];
+        }
+        last = dirty[i] + 1;
+    }
+    upload(first, last);
+
+    for (u32 row : dirty) {
+        dirty_flags[row] = 0;
+    }
+    dirty.clear();
+    return uploads;
+}
+
+void BoardTexture::set_fade(sf::Vector2f fade_in, sf::Vector2f fade_out, float alpha) {
+    shader.setUniform("fade_in", fade_in);
+    shader.setUniform("fade_out", fade_out);
+    shader.setUniform("fade", alpha);
+}
+
+void BoardTexture::draw(sf::RenderTarget& target) const {
+    sf::RenderStates states;
+    states.shader = &shader;
+    target.draw(quad, 6, sf::PrimitiveType::Triangles, states);
+}
+
+#define INSTANTIATE(D) \
+    template UploadCounters BoardTexture::reset(const Bitboard<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "board_vertices.h"
+
+// Clean tiles between two dirty ranges are uploaded along with them when the gap is at most this many tiles,
+// since one bigger upload is cheaper than another driver call (32 tiles is under 4 KB of vertices)
+static constexpr u32 MERGE_GAP_TILES = 32;
+
+static sf::Color tile_color(Tile tile) {
+    switch (tile) {
+        case Tile::SNAKE: return sf::Color::White;
+        case Tile::APPLE: return sf::Color::Red;
+        case Tile::EMPTY:
+        default:          return sf::Color::Black;
+    }
+}
+
+void set_square_vertices_color(sf::Vertex* vertices, sf::Color color) {
+    for (u8 i = 0; i < 6; ++i) {
+        vertices[i].color = color;
+    }
+}
+
+void set_square_vertices_positions(sf::Vertex* vertices, const TileLayout& layout, u16 x, u16 y) {
+    float screen_x = x * layout.tile_length + layout.offset;
+    float screen_y = y * layout.tile_length + layout.offset;
+    float length = layout.square_length;
+
+    // Four corners of the square
+    sf::Vector2f TL = { screen_x, screen_y };
+    sf::Vector2f TR = { screen_x + length, screen_y };
+    sf::Vector2f BL = { screen_x, screen_y + length };
+    sf::Vector2f BR = { screen_x + length, screen_y + length };
+
+    vertices[0].position = TL;
+    vertices[1].position = BL;
+    vertices[2].position = BR;
+
+    vertices[3].position = TL;
+    vertices[4].position = BR;
+    vertices[5].position = TR;
+}
+
+BoardVertices::BoardVertices(const TileLayout& layout)
+    : layout(layout), buffer(sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Stream) {
+    const usize tiles = usize(layout.width) * layout.height;
+    vertices.resize(tiles * 6);
+    dirty.reserve(tiles);
+    dirty_flags.assign(tiles, 0);
+
+    // Positions never change, only colors
+    for (usize i = 0; i < tiles; ++i) {
+        set_square_vertices_positions(&vertices[i * 6], layout, i % layout.width, i / layout.width);
+    }
+
+    if (!buffer.create(vertices.size()))
+        throw(std::runtime_error("Failed to create vertex_buffer of size " + std::to_string(vertices.size())));
+}
+
+template<typename D>
+UploadCounters BoardVertices::reset(const Bitboard<D>& board) {
+    const usize tiles = usize(layout.width) * layout.height;
+    for (usize i = 0; i < tiles; ++i) {
+        set_square_vertices_color(&vertices[i * 6], tile_color(board.test_cell(i) ? Tile::SNAKE : Tile::EMPTY));
+    }
+    for (u32 cell : dirty) {
+        dirty_flags[cell] = 0;
+    }
+    dirty.clear();
+
+    if (!buffer.update(vertices.data()))
+        throw(std::runtime_error("Failed to copy initial vertex data to vertex_buffer"));
+    return {1, vertices.size() * sizeof(sf::Vertex)};
+}
+
+void BoardVertices::set_tile(u16 x, u16 y, Tile tile) {
+    set_color(x, y, tile_color(tile));
+}
+
+void BoardVertices::set_color(u16 x, u16 y, sf::Color color) {
+    u32 cell = u32(y) * layout.width + x;
+    set_square_vertices_color(&vertices[usize(cell) * 6], color);
+    if (!dirty_flags[cell]) {
+        dirty_flags[cell] = 1;
+        dirty.push_back(cell);
+    }
+}
+
+UploadCounters BoardVertices::flush() {
+    UploadCounters uploads{0, 0};
+    if (dirty.empty())
+        return uploads;
+
+    std::sort(dirty.begin(), dirty.end());
+
+    // [first, last) is the range of tiles waiting to be uploaded
+    auto upload = [this, &uploads](u32 first, u32 last) {
+        usize count = usize(last - first) * 6;
+        if (!buffer.update(&vertices[usize(first) * 6], count, first * 6))
+            throw(std::runtime_error("Failed to update vertex_buffer"));
+        uploads.calls++;
+        uploads.bytes += count * sizeof(sf::Vertex);
+    };
+
+    u32 first = dirty[0];
+    u32 last = first + 1;
+    for (usize i = 1; i < dirty.size(); ++i) {
+        if (dirty[i] - last > MERGE_GAP_TILES) {
+            upload(first, last);
+            first = dirty[i];
+        }
+        last = dirty[i] + 1;
+    }
+    upload(first, last);
+
+    for (u32 cell : dirty) {
+        dirty_flags[cell] = 0;
+    }
+    dirty.clear();
+    return uploads;
+}
+
+void BoardVertices::draw(sf::RenderTarget& target) const {
+    target.draw(buffer);
+}
+
+#define INSTANTIATE(D) \
+    template UploadCounters BoardVertices::reset(const Bitboard<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
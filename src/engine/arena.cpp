@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "arena.h"
+#include "snakectl.h"
+
+// Snakes per decision task. Every chunk reseeds its stream, so chunk boundaries (not threads) fix the randomness
+static constexpr u32 SNAKES_PER_CHUNK = 256;
+
+// Random picks tried before giving up on finding a free tile for an apple or a respawn
+static constexpr u32 PLACEMENT_TRIES = 64;
+
+// Apples a snake compares when it needs a new target. It heads for the closest of them
+static constexpr u32 TARGET_SAMPLES = 8;
+
+template<typename D>
+Arena<D>::Arena(const ArenaOptions& options, const D& dims)
+    : dims(dims), options(options), board(dims), rng(options.seed) {
+    owner.resize(dims.cells);
+    apple_slot.resize(dims.cells);
+    claims.resize(dims.cells);
+    for (u32 i = 0; i < dims.cells; ++i) {
+        owner[i] = FREE;
+        apple_slot[i] = 0;
+        claims[i] = 0;
+    }
+    board.clear();
+    snakes.resize(options.snakes);
+    claimed.reserve(options.snakes);
+    dying.reserve(options.snakes);
+    apples.reserve(options.apples);
+    if (options.threads > 1)
+        pool = std::make_unique<ThreadPool>(options.threads);
+}
+
+template<typename D>
+u32 Arena<D>::alive_count() const {
+    u32 count = 0;
+    for (const ArenaSnake& snake : snakes) {
+        count += snake.alive;
+    }
+    return count;
+}
+
+template<typename D>
+u32 Arena<D>::longest_snake() const {
+    u32 longest = 0;
+    for (const ArenaSnake& snake : snakes) {
+        if (snake.alive)
+            longest = std::max(longest, snake.body.size());
+    }
+    return longest;
+}
+
+// A random tile with no snake and no apple, or NO_CELL if none turned up
+template<typename D>
+static u32 random_free_cell(Arena<D>& arena) {
+    for (u32 i = 0; i < PLACEMENT_TRIES; ++i) {
+        const u32 cell = random_below(arena.rng, arena.dims.cells);
+        if (arena.owner[cell] == Arena<D>::FREE && arena.apple_slot[cell] == 0)
+            return cell;
+    }
+    return Arena<D>::NO_CELL;
+}
+
+template<typename D>
+static void spawn_arena_apple(Arena<D>& arena) {
+    const u32 cell = random_free_cell(arena);
+    if (cell == Arena<D>::NO_CELL)
+        return;
+    arena.apples.push_back(cell);
+    arena.apple_slot[cell] = static_cast<u32>(arena.apples.size());
+}
+
+template<typename D>
+static void remove_arena_apple(Arena<D>& arena, u32 cell) {
+    const u32 index = arena.apple_slot[cell] - 1;
+    const u32 last = arena.apples.back();
+    arena.apples[index] = last;
+    arena.apple_slot[last] = index + 1;
+    arena.apples.pop_back();
+    arena.apple_slot[cell] = 0;
+}
+
+template<typename D>
+static void occupy(Arena<D>& arena, u32 snake_index, u32 cell) {
+    ArenaSnake& snake = arena.snakes[snake_index];
+    if (snake.body.full()) {
+        RingBuffer<u32, 0> grown(snake.body.capacity * 2);
+        for (u32 i = 0; i < snake.body.size(); ++i) {
+            grown.push_back(snake.body[i]);
+        }
+        snake.body = std::move(grown);
+    }
+    snake.body.push_back(cell);
+    arena.owner[cell] = snake_index + 1;
+    const std::array<u16, 2> p = arena.dims.cell_position(cell);
+    arena.board.set(p[0], p[1]);
+}
+
+template<typename D>
+static void vacate(Arena<D>& arena, u32 cell) {
+    arena.owner[cell] = Arena<D>::FREE;
+    const std::array<u16, 2> p = arena.dims.cell_position(cell);
+    arena.board.reset(p[0], p[1]);
+}
+
+// New one-tile snake on a random free tile. Stays dead if the board is too crowded to find one
+template<typename D>
+static void spawn_arena_snake(Arena<D>& arena, u32 snake_index) {
+    const u32 cell = random_free_cell(arena);
+    if (cell == Arena<D>::NO_CELL)
+        return;
+    ArenaSnake& snake = arena.snakes[snake_index];
+    snake.body.clear();
+    snake.direction = static_cast<Direction>(random_below(arena.rng, 4u));
+    snake.grow_timer = START_GROW_TIMER;
+    snake.alive = true;
+    snake.target = Arena<D>::NO_CELL;
+    occupy(arena, snake_index, cell);
+}
+
+template<typename D>
+void init_arena(Arena<D>& arena) {
+    for (u32 i = 0; i < arena.options.snakes; ++i) {
+        spawn_arena_snake(arena, i);
+    }
+    for (u32 i = 0; i < arena.options.apples; ++i) {
+        spawn_arena_apple(arena);
+    }
+}
+
+// Decide phase for snakes [first, last). Reads the shared board, writes only to those snakes
+template<typename D>
+static void decide_chunk(Arena<D>& arena, u32 first, u32 last, u64 chunk_seed) {
+    const D& dims = arena.dims;
+    Xoshiro256& rng = get_rng();
+    const Xoshiro256 saved = rng;
+    rng.seed(chunk_seed);
+
+    for (u32 i = first; i < last; ++i) {
+        ArenaSnake& snake = arena.snakes[i];
+        if (!snake.alive)
+            continue;
+        const u32 head = snake.body.back();
+        const std::array<u16, 2> head_position = dims.cell_position(head);
+
+        // The target may have been eaten by someone else
+        if ((snake.target == Arena<D>::NO_CELL || arena.apple_slot[snake.target] == 0) && !arena.apples.empty()) {
+            u32 best_distance = ~u32(0);
+            for (u32 sample = 0; sample < TARGET_SAMPLES; ++sample) {
+                const u32 apple = arena.apples[random_below(rng, static_cast<u32>(arena.apples.size()))];
+                const std::array<u16, 2> p = dims.cell_position(apple);
+                const u32 distance = std::abs(int(p[0]) - int(head_position[0])) + std::abs(int(p[1]) - int(head_position[1]));
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    snake.target = apple;
+                }
+            }
+        }
+        const std::array<u16, 2> target = snake.target != Arena<D>::NO_CELL ? dims.cell_position(snake.target) : head_position;
+
+        snake.direction = snake_decide(target, head_position, snake.direction, arena.board);
+        if (!dims.neighbor_cell(head, snake.direction, snake.next))
+            snake.next = Arena<D>::NO_CELL;
+    }
+
+    rng = saved;
+}
+
+template<typename D>
+void arena_tick(Arena<D>& arena) {
+    const u32 snake_count = static_cast<u32>(arena.snakes.size());
+    const u64 tick_seed = derive_seed(arena.options.seed, arena.stats.ticks);
+
+    // ======================== Decide ======================== //
+
+    for (u32 first = 0; first < snake_count; first += SNAKES_PER_CHUNK) {
+        const u32 last = std::min(snake_count, first + SNAKES_PER_CHUNK);
+        const u64 chunk_seed = derive_seed(tick_seed, first / SNAKES_PER_CHUNK);
+        if (arena.pool != nullptr)
+            arena.pool->submit([&arena, first, last, chunk_seed] { decide_chunk(arena, first, last, chunk_seed); });
+        else
+            decide_chunk(arena, first, last, chunk_seed);
+    }
+    if (arena.pool != nullptr)
+        arena.pool->wait();
+
+    // ======================== Resolve ======================== //
+
+    arena.claimed.clear();
+    arena.dying.clear();
+    for (u32 i = 0; i < snake_count; ++i) {
+        const ArenaSnake& snake = arena.snakes[i];
+        if (!snake.alive || snake.next == Arena<D>::NO_CELL)
+            continue;
+        if (arena.claims[snake.next]++ == 0)
+            arena.claimed.push_back(snake.next);
+    }
+
+    // A tile is free to move onto if nobody owns it, or it is the tail of a snake that is not growing
+    auto vacated = [&arena](u32 cell) {
+        const u32 owner = arena.owner[cell];
+        if (owner == Arena<D>::FREE)
+            return true;
+        const ArenaSnake& snake = arena.snakes[owner - 1];
+        return snake.grow_timer == 0 && snake.body.front() == cell;
+    };
+    for (u32 i = 0; i < snake_count; ++i) {
+        const ArenaSnake& snake = arena.snakes[i];
+        if (!snake.alive)
+            continue;
+        if (snake.next == Arena<D>::NO_CELL || arena.claims[snake.next] > 1 || !vacated(snake.next))
+            arena.dying.push_back(i);
+    }
+    for (u32 cell : arena.claimed) {
+        arena.claims[cell] = 0;
+    }
+    for (u32 i : arena.dying) {
+        arena.snakes[i].alive = false;
+    }
+
+    // Tails leave first, so heads can move onto them
+    for (ArenaSnake& snake : arena.snakes) {
+        if (!snake.alive)
+            continue;
+        if (snake.grow_timer != 0)
+            snake.grow_timer--;
+        else {
+            vacate(arena, snake.body.front());
+            snake.body.pop_front();
+        }
+    }
+    // Only the tiles still owned by a dead snake. Its vacated tail may already be someone else's
+    for (u32 i : arena.dying) {
+        ArenaSnake& snake = arena.snakes[i];
+        for (u32 j = 0; j < snake.body.size(); ++j) {
+            if (arena.owner[snake.body[j]] == i + 1)
+                vacate(arena, snake.body[j]);
+        }
+        snake.body.clear();
+    }
+    for (u32 i = 0; i < snake_count; ++i) {
+        ArenaSnake& snake = arena.snakes[i];
+        if (!snake.alive)
+            continue;
+        occupy(arena, i, snake.next);
+        if (arena.apple_slot[snake.next] != 0) {
+            remove_arena_apple(arena, snake.next);
+            snake.grow_timer += GROW_RATE;
+            arena.stats.apples_eaten++;
+            spawn_arena_apple(arena);
+        }
+    }
+
+    // Top the apples back up (some may not have found room earlier), then respawn the dead,
+    // including any that found no room on an earlier tick
+    while (arena.apples.size() < arena.options.apples) {
+        const usize before = arena.apples.size();
+        spawn_arena_apple(arena);
+        if (arena.apples.size() == before)
+            break;
+    }
+    for (u32 i = 0; i < snake_count; ++i) {
+        if (!arena.snakes[i].alive)
+            spawn_arena_snake(arena, i);
+    }
+
+    arena.stats.deaths += arena.dying.size();
+    arena.stats.ticks++;
+}
+
+#define INSTANTIATE(D) \
+    template struct Arena<D>; \
+    template void init_arena(Arena<D>&); \
+    template void arena_tick(Arena<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <memory>
+
+#include "batch.h"
+#include "random_utils.h"
+#include "thread_pool.h"
+
+// Games per task. Big enough to amortize queueing, small enough to leave something to steal
+static constexpr u32 GAMES_PER_TASK = 16;
+
+std::vector<GameSummary> run_batch(u32 games, u32 threads, u64 master_seed, ControllerKind controller_kind,
+                                   u16 width, u16 height, const RolloutOptions& rollout, const BlindParams& blind) {
+    RolloutOptions game_rollout = rollout;
+    game_rollout.threads = 1;
+
+    std::vector<GameSummary> results(games);
+    ThreadPool pool(threads);
+
+    with_board_dims(width, height, [&](auto dims) {
+        using D = decltype(dims);
+        for (u32 first = 0; first < games; first += GAMES_PER_TASK) {
+            u32 last = std::min(games, first + GAMES_PER_TASK);
+            pool.submit([&results, first, last, master_seed, controller_kind, game_rollout, blind, dims] {
+                // On the heap: a GameState for a large fixed board is too big for a worker's stack
+                auto state = std::make_unique<GameState<D>>(dims);
+                Controller<D> controller(controller_kind, dims, game_rollout, blind);
+                for (u32 i = first; i < last; ++i) {
+                    seed_rng(derive_seed(master_seed, i));
+                    results[i] = run_headless_game(*state, controller);
+                }
+            });
+        }
+        pool.wait();
+    });
+
+    return results;
+}
+
+BatchStats summarize_batch(const std::vector<GameSummary>& results, double seconds) {
+    BatchStats stats{};
+    stats.games = static_cast<u32>(results.size());
+    stats.seconds = seconds;
+    stats.games_per_second = seconds > 0 ? results.size() / seconds : 0;
+    if (results.empty())
+        return stats;
+
+    std::vector<u32> lengths, ticks;
+    lengths.reserve(results.size());
+    ticks.reserve(results.size());
+    double length_sum = 0, tick_sum = 0;
+    for (const GameSummary& r : results) {
+        lengths.push_back(r.length);
+        ticks.push_back(r.ticks);
+        length_sum += r.length;
+        tick_sum += r.ticks;
+    }
+    std::sort(lengths.begin(), lengths.end());
+    std::sort(ticks.begin(), ticks.end());
+
+    stats.mean_length = length_sum / results.size();
+    stats.median_length = sorted_percentile(lengths, 0.5);
+    stats.p99_length = sorted_percentile(lengths, 0.99);
+    stats.mean_ticks = tick_sum / results.size();
+    stats.median_ticks = sorted_percentile(ticks, 0.5);
+    stats.p99_ticks = sorted_percentile(ticks, 0.99);
+    return stats;
+}
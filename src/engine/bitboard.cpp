@@ -0,0 +1,136 @@
+#include "bitboard.h"
+
+static inline u32 popcount(u64 word) {
+    return static_cast<u32>(__builtin_popcountll(word));
+}
+
+template<typename D>
+Bitboard<D>::Bitboard(const D& dims) : dims(dims) {
+    words.resize(dims.board_words);
+    clear();
+}
+
+template<typename D>
+void Bitboard<D>::clear() {
+    const u32 row_words = dims.row_words;
+    for (u32 y = 0; y < dims.height; ++y) {
+        for (u32 w = 0; w < row_words; ++w) {
+            words[y * row_words + w] = 0;
+        }
+        words[y * row_words + row_words - 1] = padding_mask();
+    }
+}
+
+template<typename D>
+u8 Bitboard<D>::free_neighbors(u16 x, u16 y) const {
+    u8 mask = 0;
+    if (y + 1 < dims.height && !test(x, y + 1)) mask |= 1 << UP;
+    if (y > 0 && !test(x, y - 1))               mask |= 1 << DOWN;
+    if (x > 0 && !test(x - 1, y))               mask |= 1 << LEFT;
+    if (x + 1 < dims.width && !test(x + 1, y))  mask |= 1 << RIGHT;
+    return mask;
+}
+
+template<typename D>
+u32 Bitboard<D>::count_free() const {
+    u32 count = 0;
+    for (u32 i = 0; i < dims.board_words; ++i) {
+        count += popcount(~words[i]);
+    }
+    return count;
+}
+
+template<typename D>
+void neighbor_free_masks(const Bitboard<D>& board, Bitboard<D> out[4]) {
+    const D& dims = board.dims;
+    const u32 row_words = dims.row_words;
+    for (u32 y = 0; y < dims.height; ++y) {
+        for (u32 w = 0; w < row_words; ++w) {
+            u32 i = y * row_words + w;
+            u64 valid = (w == row_words - 1) ? ~board.padding_mask() : ~u64(0);
+            u64 free = ~board.words[i];
+            u64 free_prev = (w > 0) ? ~board.words[i - 1] : 0;
+            u64 free_next = (w + 1 < row_words) ? ~board.words[i + 1] : 0;
+
+            // Neighbor at x + 1 moves down one bit, neighbor at x - 1 moves up one bit (carrying across words)
+            out[RIGHT].words[i] = ((free >> 1) | (free_next << 63)) & valid;
+            out[LEFT].words[i] = ((free << 1) | (free_prev >> 63)) & valid;
+            out[UP].words[i] = (y + 1 < dims.height) ? ~board.words[i + row_words] & valid : 0;
+            out[DOWN].words[i] = (y > 0) ? ~board.words[i - row_words] & valid : 0;
+        }
+    }
+}
+
+// Spreads the region sideways along its row until it fills every free run it touches. Returns whether it grew
+static bool expand_row(u64* region, const u64* board_row, u32 row_words) {
+    bool grew = false;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (u32 w = 0; w < row_words; ++w) {
+            u64 grown = region[w] | (region[w] << 1) | (region[w] >> 1);
+            if (w > 0)
+                grown |= region[w - 1] >> 63;
+            if (w + 1 < row_words)
+                grown |= region[w + 1] << 63;
+            grown &= ~board_row[w];
+            if (grown != region[w]) {
+                region[w] = grown;
+                changed = true;
+                grew = true;
+            }
+        }
+    }
+    return grew;
+}
+
+template<typename D>
+u32 flood_fill(const Bitboard<D>& board, u16 x, u16 y, Bitboard<D>& region) {
+    const D& dims = board.dims;
+    const u32 row_words = dims.row_words;
+    for (u32 i = 0; i < dims.board_words; ++i) {
+        region.words[i] = 0;
+    }
+    region.set(x, y);
+
+    // Alternate top-down and bottom-up sweeps. Each row takes in the rows next to it and then spreads sideways,
+    // so a sweep can carry the region across the whole board instead of one tile per pass
+    bool changed = true;
+    bool downward = true;
+    while (changed) {
+        changed = false;
+        for (u32 i = 0; i < dims.height; ++i) {
+            u32 row = downward ? i : dims.height - 1 - i;
+            u64* r = &region.words[row * row_words];
+            const u64* b = &board.words[row * row_words];
+
+            for (u32 w = 0; w < row_words; ++w) {
+                u64 grown = r[w];
+                if (row > 0)
+                    grown |= region.words[(row - 1) * row_words + w];
+                if (row + 1 < dims.height)
+                    grown |= region.words[(row + 1) * row_words + w];
+                grown &= ~b[w];
+                if (grown != r[w]) {
+                    r[w] = grown;
+                    changed = true;
+                }
+            }
+            if (expand_row(r, b, row_words))
+                changed = true;
+        }
+        downward = !downward;
+    }
+
+    u32 count = 0;
+    for (u32 i = 0; i < dims.board_words; ++i) {
+        count += popcount(region.words[i]);
+    }
+    return count;
+}
+
+#define INSTANTIATE(D) \
+    template struct Bitboard<D>; \
+    template void neighbor_free_masks(const Bitboard<D>&, Bitboard<D>[4]); \
+    template u32 flood_fill(const Bitboard<D>&, u16, u16, Bitboard<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,126 @@
+#include "compact_state.h"
+#include "random_utils.h"
+
+template<typename D>
+void compact_state(const GameState<D>& state, CompactState<D>& out) {
+    const D& dims = state.dims;
+    const auto& body = state.snake.body;
+
+    out.board = state.board;
+    out.tail = body.front();
+    out.head = body.back();
+    out.length = body.size();
+    out.first_link = 0;
+    for (u32 i = 0; i + 1 < body.size(); ++i) {
+        out.set_link(i, dims.direction_between(body[i], body[i + 1]));
+    }
+    out.apple = dims.cell_index(state.apple_position[0], state.apple_position[1]);
+    out.ticks = state.ticks;
+    out.last_apple_tick = state.last_apple_tick;
+    out.direction = state.snake.direction;
+    out.grow_timer = state.snake.grow_timer;
+    out.death_cause = state.death_cause;
+    out.rules = state.rules;
+}
+
+template<typename D>
+void expand_state(const CompactState<D>& compact, GameState<D>& out) {
+    const D& dims = compact.dims;
+
+    out.board = compact.board;
+    out.free_cells.fill();
+    out.snake.body.clear();
+    u32 cell = compact.tail;
+    for (u32 i = 0; i < compact.length; ++i) {
+        if (i > 0)
+            dims.neighbor_cell(cell, compact.link(compact.link_index(i - 1)), cell);
+        out.snake.body.push_back(static_cast<typename D::cell_t>(cell));
+        out.free_cells.remove(cell);
+    }
+    out.snake.direction = compact.direction;
+    out.snake.grow_timer = compact.grow_timer;
+    out.apple_position = dims.cell_position(compact.apple);
+    out.ticks = compact.ticks;
+    out.last_apple_tick = compact.last_apple_tick;
+    out.death_cause = compact.death_cause;
+    out.rules = compact.rules;
+}
+
+template<typename D>
+bool step(CompactState<D>& state, Direction direction) {
+    const D& dims = state.dims;
+    state.direction = direction;
+    state.ticks++;
+
+    u32 next_head;
+    if (!dims.neighbor_cell(state.head, direction, next_head)) {
+        state.death_cause = DeathCause::WALL;
+        return false;
+    }
+
+    // Tail first, in case the head moves onto the tile it leaves
+    if (state.grow_timer != 0)
+        state.grow_timer--;
+    else {
+        const std::array<u16, 2> tail = dims.cell_position(state.tail);
+        state.board.reset(tail[0], tail[1]);
+        state.length--;
+        if (state.length > 0) {
+            dims.neighbor_cell(state.tail, state.link(state.first_link), state.tail);
+            state.first_link = state.link_index(1);
+        }
+    }
+
+    const std::array<u16, 2> head = dims.cell_position(next_head);
+    if (state.board.test(head[0], head[1])) {
+        state.death_cause = DeathCause::SELF;
+        return false;
+    }
+    // A one-tile snake that just moved has no links, and its new head is also its tail
+    if (state.length == 0)
+        state.tail = next_head;
+    else
+        state.set_link(state.link_index(state.length - 1), direction);
+    state.length++;
+    state.head = next_head;
+    state.board.set(head[0], head[1]);
+
+    if (next_head == state.apple) {
+        state.grow_timer += state.rules.grow_rate;
+        state.last_apple_tick = state.ticks;
+        if (state.length == dims.cells) {
+            state.death_cause = DeathCause::BOARD_FULL;
+            return false;
+        }
+        spawn_apple(state);
+    }
+    return true;
+}
+
+template<typename D>
+void spawn_apple(CompactState<D>& state) {
+    const D& dims = state.dims;
+    // k-th free tile, counting a word (64 tiles) at a time. Padding bits are set, so ~word is exactly the free tiles
+    u32 k = random_int(u32(0), dims.cells - state.length - 1);
+    for (u32 i = 0; i < dims.board_words; ++i) {
+        u64 free = ~state.board.words[i];
+        const u32 count = static_cast<u32>(__builtin_popcountll(free));
+        if (k >= count) {
+            k -= count;
+            continue;
+        }
+        for (; k > 0; --k) {
+            free &= free - 1;
+        }
+        const u32 x = (i % dims.row_words) * 64 + static_cast<u32>(__builtin_ctzll(free));
+        state.apple = dims.cell_index(static_cast<u16>(x), static_cast<u16>(i / dims.row_words));
+        return;
+    }
+}
+
+#define INSTANTIATE(D) \
+    template void compact_state(const GameState<D>&, CompactState<D>&); \
+    template void expand_state(const CompactState<D>&, GameState<D>&); \
+    template bool step(CompactState<D>&, Direction); \
+    template void spawn_apple(CompactState<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,71 @@
+#include "controller.h"
+#include "snakectl.h"
+
+template<typename D>
+Controller<D>::Controller(ControllerKind kind, const D& dims, const RolloutOptions& rollout_options, const BlindParams& blind_params)
+    : kind(kind), blind_params(blind_params) {
+    if (kind == ControllerKind::PATHFINDER)
+        pathfinder = std::make_unique<Pathfinder<D>>(dims);
+    if (kind == ControllerKind::BLIND_REACHABILITY)
+        reachability = std::make_unique<Reachability<D>>(dims);
+    if (kind == ControllerKind::ROLLOUT)
+        rollout = std::make_unique<RolloutPlanner<D>>(rollout_options, dims);
+    if (kind == ControllerKind::HAMILTON)
+        hamilton = std::make_unique<HamiltonPlanner<D>>(dims);
+    if (kind == ControllerKind::PLAYER)
+        player = std::make_unique<PlayerInput>();
+}
+
+template<typename D>
+Direction Controller<D>::decide(const GameState<D>& state) {
+    switch (kind) {
+        case ControllerKind::PATHFINDER:
+            return pathfinder_decide(*pathfinder, state);
+        case ControllerKind::ROLLOUT:
+            return rollout_decide(*rollout, state);
+        case ControllerKind::HAMILTON:
+            return hamilton_decide(*hamilton, state);
+        case ControllerKind::PLAYER:
+            return player->decide(state);
+        case ControllerKind::BLIND_REACHABILITY:
+            reachability->sync(state);
+            return snake_decide(state.apple_position, head_position(state), state.snake.direction, state.board, reachability.get(), blind_params);
+        case ControllerKind::BLIND:
+        default:
+            return snake_decide<D>(state.apple_position, head_position(state), state.snake.direction, state.board, nullptr, blind_params);
+    }
+}
+
+bool parse_controller_kind(const std::string& name, ControllerKind& kind) {
+    if (name == "blind")
+        kind = ControllerKind::BLIND;
+    else if (name == "blind-reach")
+        kind = ControllerKind::BLIND_REACHABILITY;
+    else if (name == "path")
+        kind = ControllerKind::PATHFINDER;
+    else if (name == "rollout")
+        kind = ControllerKind::ROLLOUT;
+    else if (name == "hamilton")
+        kind = ControllerKind::HAMILTON;
+    else if (name == "player")
+        kind = ControllerKind::PLAYER;
+    else
+        return false;
+    return true;
+}
+
+const char* controller_kind_name(ControllerKind kind) {
+    switch (kind) {
+        case ControllerKind::BLIND:              return "blind";
+        case ControllerKind::BLIND_REACHABILITY: return "blind-reach";
+        case ControllerKind::PATHFINDER:         return "path";
+        case ControllerKind::ROLLOUT:            return "rollout";
+        case ControllerKind::HAMILTON:           return "hamilton";
+        case ControllerKind::PLAYER:             return "player";
+    }
+    return "unknown";
+}
+
+#define INSTANTIATE(D) \
+    template struct Controller<D>;
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,124 @@
+#include "game.h"
+#include "phase_stats.h"
+#include "random_utils.h"
+
+template<typename D>
+void init_game(GameState<D>& state) {
+    const D& dims = state.dims;
+    SNAKE_PHASE_STATS_THREAD_START();
+
+    // Initialize board and snake data. The head starts at dims.start_position() and the body trails to the left
+    state.board.clear();
+    state.free_cells.fill();
+    state.snake.direction = START_DIRECTION;
+    state.snake.grow_timer = state.rules.start_grow_timer;
+    state.snake.body.clear();
+
+    const std::array<u16, 2> start = dims.start_position();
+    for (u32 i = 0; i < START_LENGTH; ++i) {
+        u16 x = static_cast<u16>(start[0] - (START_LENGTH - 1) + i);
+        state.board.set(x, start[1]);
+        state.free_cells.remove(dims.cell_index(x, start[1]));
+        state.snake.body.push_back(static_cast<typename D::cell_t>(dims.cell_index(x, start[1])));
+    }
+
+    state.ticks = 0;
+    state.last_apple_tick = 0;
+    state.death_cause = DeathCause::NONE;
+
+    spawn_apple(state);
+}
+
+template<typename D>
+bool step(GameState<D>& state, Direction direction, StepEvents* events) {
+    const D& dims = state.dims;
+    Snake<D>& snake = state.snake;
+    snake.direction = direction;
+    state.ticks++;
+
+    // Get the next head position and check if out of bounds
+    std::array<u16, 2> next_head_position = head_position(state);
+
+    switch (snake.direction) {
+        case UP:    next_head_position[1]++; break;
+        case DOWN:  next_head_position[1]--; break;
+        case RIGHT: next_head_position[0]++; break;
+        case LEFT:  next_head_position[0]--; break;
+    }
+    if (next_head_position[0] >= dims.width || next_head_position[1] >= dims.height) {
+        state.death_cause = DeathCause::WALL;
+        return false;
+    }
+    // Would check for collision here, but tail must be popped first just in case head ends up at the previous tail position
+
+    // Tail
+    // Check if growing. If not, pop front (tail) of snake
+    if (snake.grow_timer != 0)
+        snake.grow_timer--;
+    else {
+        const u32 tail_cell = snake.body.front();
+        const std::array<u16, 2> tail = dims.cell_position(tail_cell);
+        state.board.reset(tail[0], tail[1]);
+        state.free_cells.insert(tail_cell);
+        snake.body.pop_front();
+        if (events != nullptr) {
+            events->tail_popped = true;
+            events->tail_position = tail;
+        }
+    }
+
+    // Head
+    // Check for collisions. If none, push the next head position
+    if (state.board.test(next_head_position[0], next_head_position[1])) {
+        state.death_cause = DeathCause::SELF;
+        return false;
+    }
+    const u32 head_cell = dims.cell_index(next_head_position[0], next_head_position[1]);
+    snake.body.push_back(static_cast<typename D::cell_t>(head_cell));
+    state.board.set(next_head_position[0], next_head_position[1]);
+    state.free_cells.remove(head_cell);
+    if (events != nullptr) {
+        events->head_pushed = true;
+        events->head_position = next_head_position;
+    }
+
+    // Apple!
+    if (next_head_position == state.apple_position) {
+        snake.grow_timer += state.rules.grow_rate;
+        state.last_apple_tick = state.ticks;
+        if (state.free_cells.count == 0) {
+            state.death_cause = DeathCause::BOARD_FULL;
+            return false;
+        }
+        spawn_apple(state);
+        if (events != nullptr)
+            events->apple_spawned = true;
+    }
+
+    return true;
+}
+
+template<typename D>
+void spawn_apple(GameState<D>& state) {
+    SNAKE_TIME_PHASE(Phase::SPAWN_APPLE);
+    // Uniform over the free tiles without retrying, so this costs the same on an empty or a nearly full board
+    u32 cell = state.free_cells.cells[random_int(u32(0), state.free_cells.count - 1)];
+    state.apple_position = state.dims.cell_position(cell);
+}
+
+const char* death_cause_name(DeathCause cause) {
+    switch (cause) {
+        case DeathCause::NONE:       return "none";
+        case DeathCause::WALL:       return "wall";
+        case DeathCause::SELF:       return "self";
+        case DeathCause::BOARD_FULL: return "board full";
+        case DeathCause::STARVED:    return "starved";
+    }
+    return "unknown";
+}
+
+#define INSTANTIATE(D) \
+    template void init_game(GameState<D>&); \
+    template bool step(GameState<D>&, Direction, StepEvents*); \
+    template void spawn_apple(GameState<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,234 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hamiltonctl.h"
+#include "replay.h"
+#include "snakectl.h"
+
+namespace fs = std::filesystem;
+
+HamiltonCycle::HamiltonCycle() : width(0), height(0), cells(0), position(nullptr) {}
+
+HamiltonCycle::~HamiltonCycle() = default;
+
+bool build_hamilton_cycle(u16 width, u16 height, u32* position) {
+    if (width < 2 || height < 2 || (width % 2 != 0 && height % 2 != 0))
+        return false;
+    u32 next = 0;
+    if (width % 2 == 0) {
+        // Columns up and down over rows 1 to height - 1. The last column ends at row 1, then row 0 leads home
+        for (u32 x = 0; x < width; ++x) {
+            for (u32 i = 1; i < height; ++i) {
+                const u32 y = (x % 2 == 0) ? i : height - i;
+                position[y * width + x] = next++;
+            }
+        }
+        for (u32 x = width; x-- > 0;) {
+            position[x] = next++;
+        }
+    }
+    else {
+        // The same with rows and columns swapped: rows over columns 1 to width - 1, then column 0 leads home
+        for (u32 y = 0; y < height; ++y) {
+            for (u32 i = 1; i < width; ++i) {
+                const u32 x = (y % 2 == 0) ? i : width - i;
+                position[y * width + x] = next++;
+            }
+        }
+        for (u32 y = height; y-- > 0;) {
+            position[y * width] = next++;
+        }
+    }
+    return true;
+}
+
+std::string hamilton_cache_path(u16 width, u16 height) {
+    fs::path directory;
+    if (const char* cache_dir = std::getenv("SNAKE_CACHE_DIR"))
+        directory = cache_dir;
+    else if (const char* xdg_cache = std::getenv("XDG_CACHE_HOME"))
+        directory = fs::path(xdg_cache) / "snake";
+    else if (const char* home = std::getenv("HOME"))
+        directory = fs::path(home) / ".cache" / "snake";
+    else
+        return "";
+    return (directory / ("hamilton_" + std::to_string(width) + "x" + std::to_string(height) + ".bin")).string();
+}
+
+// Maps path if it holds the table for width x height
+static std::unique_ptr<MappedFile> map_cached_cycle(const std::string& path, u16 width, u16 height) {
+    std::unique_ptr<MappedFile> file;
+    try {
+        file = std::make_unique<MappedFile>(path, false);
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
+    const u32 cells = u32(width) * height;
+    if (file->size() != sizeof(HamiltonCacheHeader) + usize(cells) * sizeof(u32))
+        return nullptr;
+    HamiltonCacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, HAMILTON_MAGIC, sizeof(header.magic)) != 0 || header.version != HAMILTON_VERSION ||
+        header.width != width || header.height != height || header.cells != cells)
+        return nullptr;
+    return file;
+}
+
+// Temporary file and rename, so other processes never map a half-written table. False on any failure
+static bool write_cached_cycle(const std::string& path, const HamiltonCycle& cycle) {
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+    if (error)
+        return false;
+
+    HamiltonCacheHeader header{};
+    std::memcpy(header.magic, HAMILTON_MAGIC, sizeof(header.magic));
+    header.version = HAMILTON_VERSION;
+    header.width = cycle.width;
+    header.height = cycle.height;
+    header.cells = cycle.cells;
+
+    // Unique per process, so processes building the same table at once do not write into each other's file
+    const std::string temp_path = path + ".tmp" + std::to_string(::getpid());
+    const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+    auto write_all = [fd](const void* data, usize size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        while (size > 0) {
+            const ssize_t n = ::write(fd, bytes, size);
+            if (n <= 0)
+                return false;
+            bytes += n;
+            size -= static_cast<usize>(n);
+        }
+        return true;
+    };
+    const bool written = write_all(&header, sizeof(header)) && write_all(cycle.table.data(), cycle.table.size() * sizeof(u32));
+    if (::close(fd) != 0 || !written || ::rename(temp_path.c_str(), path.c_str()) != 0) {
+        ::unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const HamiltonCycle> open_hamilton_cycle(u16 width, u16 height) {
+    if (width < 2 || height < 2 || (width % 2 != 0 && height % 2 != 0))
+        return nullptr;
+    auto cycle = std::make_shared<HamiltonCycle>();
+    cycle->width = width;
+    cycle->height = height;
+    cycle->cells = u32(width) * height;
+
+    const std::string path = hamilton_cache_path(width, height);
+    if (!path.empty())
+        cycle->file = map_cached_cycle(path, width, height);
+    if (cycle->file == nullptr) {
+        cycle->table.resize(cycle->cells);
+        build_hamilton_cycle(width, height, cycle->table.data());
+        // Map the written file rather than keep the table, so the memory is shared with other processes
+        if (!path.empty() && write_cached_cycle(path, *cycle))
+            cycle->file = map_cached_cycle(path, width, height);
+        if (cycle->file != nullptr)
+            std::vector<u32>().swap(cycle->table);
+    }
+    cycle->position = cycle->file != nullptr
+        ? reinterpret_cast<const u32*>(cycle->file->data() + sizeof(HamiltonCacheHeader))
+        : cycle->table.data();
+    return cycle;
+}
+
+std::shared_ptr<const HamiltonCycle> load_hamilton_cycle(u16 width, u16 height) {
+    static std::mutex mutex;
+    static std::map<std::pair<u16, u16>, std::shared_ptr<const HamiltonCycle>> loaded;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto found = loaded.find({width, height});
+    if (found != loaded.end())
+        return found->second;
+    return loaded[{width, height}] = open_hamilton_cycle(width, height);
+}
+
+template<typename D>
+HamiltonPlanner<D>::HamiltonPlanner(const D& dims) : dims(dims), cycle(load_hamilton_cycle(dims.width, dims.height)) {}
+
+template<typename D>
+Direction hamilton_decide(const HamiltonPlanner<D>& planner, const GameState<D>& state) {
+    if (planner.cycle == nullptr)
+        return snake_decide(state.apple_position, head_position(state), state.snake.direction, state.board);
+
+    const D& dims = planner.dims;
+    const u32* position = planner.cycle->position;
+    const u32 cells = dims.cells;
+    const u32 head = state.snake.body.back();
+    const u32 head_order = position[head];
+    // Cells from the head to cell going forward along the cycle
+    auto distance = [&](u32 cell) {
+        const u32 p = position[cell];
+        return p >= head_order ? p - head_order : p + cells - head_order;
+    };
+
+    const u32 apple = dims.cell_index(state.apple_position[0], state.apple_position[1]);
+    const u32 to_apple = distance(apple);
+    const u32 length = snake_length(state);
+    // A one tile snake is its own tail, with the whole cycle ahead of it
+    const u32 to_tail = length > 1 ? distance(state.snake.body.front()) : cells;
+    const u32 grow_timer = state.snake.grow_timer;
+
+    // The body lies along the cycle in order from tail to head, so every tile from the head up to the tail is
+    // free. Following the cycle keeps it that way, and is safe for good once the body is also contiguous on it:
+    // the tile ahead is then free, or the tail, until the board is full
+    // A shortcut to the tile d ahead skips d - 1 free tiles, which only become room again once the tail has
+    // passed them. It is taken only if plain cycle following from there still reaches the current apple (the only
+    // source of growth until it is eaten) with the tail past the skipped tiles, so the body is contiguous again
+    // before any new apple can spawn, and without running into the tail on the way. Every shortcut leads to such
+    // a state and following the cycle never leaves one, so the snake never dies
+    // After the move the snake still grows for grown ticks and is after_length long. The tail has to move
+    // after_length - 1 times to pass the old head, and does so on every tick that does not grow
+    const u32 grown = grow_timer > 0 ? grow_timer - 1 : 0;
+    const u32 after_length = grow_timer > 0 ? length + 1 : length;
+
+    Direction best = state.snake.direction;
+    u32 best_distance = 0;
+    for (u8 dir = 0; dir < 4; ++dir) {
+        u32 neighbor;
+        if (!dims.neighbor_cell(head, dir, neighbor))
+            continue;
+        const u32 d = distance(neighbor);
+        // The next cell on the cycle, taken whatever is there
+        if (d == 1) {
+            if (best_distance == 0) {
+                best = static_cast<Direction>(dir);
+                best_distance = 1;
+            }
+            continue;
+        }
+        // Short of the apple (eating it right away would spawn the next one with tiles still skipped), and short
+        // of the tail, so the body stays in cycle order
+        if (d <= best_distance || d >= to_apple || d >= to_tail)
+            continue;
+        if (state.board.test_cell(neighbor))
+            continue;
+        // The apple is to_apple - d ticks away afterward: the tail must pass the old head by then
+        if (to_apple - d < grown + after_length - 1)
+            continue;
+        // Free tiles between the new head and the tail, one more if the tail moves this tick. The growth ticks
+        // come first and must not reach the tail
+        const u32 room = to_tail - d - 1 + (grow_timer == 0 ? 1 : 0);
+        if (room < grown)
+            continue;
+        best = static_cast<Direction>(dir);
+        best_distance = d;
+    }
+    return best;
+}
+
+#define INSTANTIATE(D) \
+    template struct HamiltonPlanner<D>; \
+    template Direction hamilton_decide(const HamiltonPlanner<D>&, const GameState<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
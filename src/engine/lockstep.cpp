@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <mutex>
+
+#include "lockstep.h"
+#include "random_utils.h"
+#include "thread_pool.h"
+
+static inline u32 xorshift32(u32& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// snake_decide for every lane without branches. Each lane draws one 32-bit number: the top bit is the 1/2 coin for
+// keeping a best direction of precedence 3, the low 16 bits the 2/3 laziness roll, bits 16-30 the pick among the
+// best directions (multiply-shift instead of modulo, so both rolls are off by at most 2^-15)
+// The arrays never overlap. __restrict says so, which spares the vectorized loop its run-time alias checks
+static void decide_lanes(u32 lanes, const i32* __restrict hx, const i32* __restrict hy, const i32* __restrict ax,
+                         const i32* __restrict ay, const u8* __restrict free, i32* __restrict dir, i32* __restrict nx,
+                         i32* __restrict ny, u32* __restrict state) {
+    for (u32 lane = 0; lane < lanes; ++lane) {
+        const u32 r = xorshift32(state[lane]);
+
+        const i32 d = dir[lane];
+        const i32 x = hx[lane], y = hy[lane], apple_x = ax[lane], apple_y = ay[lane];
+        const i32 moving_incorrect_y = ((y < apple_y) & (d == UP)) | ((y > apple_y) & (d == DOWN));
+        const i32 moving_incorrect_x = ((x < apple_x) & (d == LEFT)) | ((x > apple_x) & (d == RIGHT));
+
+        // 3 toward the apple, 1 when aligned with it on that axis (unless moving the wrong way on the other), else 2
+        const i32 free_bits = free[lane];
+        const i32 p_up = (2 + (y < apple_y) - ((y == apple_y) & !moving_incorrect_x)) * ((free_bits >> UP) & 1);
+        const i32 p_down = (2 + (y > apple_y) - ((y == apple_y) & !moving_incorrect_x)) * ((free_bits >> DOWN) & 1);
+        const i32 p_left = (2 + (x > apple_x) - ((x == apple_x) & !moving_incorrect_y)) * ((free_bits >> LEFT) & 1);
+        const i32 p_right = (2 + (x < apple_x) - ((x == apple_x) & !moving_incorrect_y)) * ((free_bits >> RIGHT) & 1);
+
+        const i32 best = std::max(std::max(p_up, p_down), std::max(p_left, p_right));
+        const i32 p_current = (d == UP) * p_up + (d == DOWN) * p_down + (d == LEFT) * p_left + (d == RIGHT) * p_right;
+
+        const i32 coin = static_cast<i32>(r >> 31);
+        const i32 lazy = static_cast<i32>(((r & 0xFFFF) * 3) >> 16) > 0;
+        const i32 keep = (p_current == best) & (((p_current == 3) & coin) | lazy);
+
+        // Uniform pick among the directions of best precedence
+        const i32 m_up = p_up == best, m_down = p_down == best, m_left = p_left == best, m_right = p_right == best;
+        const i32 count = m_up + m_down + m_left + m_right;
+        const i32 pick = static_cast<i32>((((r >> 16) & 0x7FFF) * static_cast<u32>(count)) >> 15);
+        const i32 picked = (m_down & (pick == m_up)) * DOWN + (m_left & (pick == m_up + m_down)) * LEFT +
+                           (m_right & (pick == m_up + m_down + m_left)) * RIGHT;
+
+        const i32 chosen = keep ? d : picked;
+        dir[lane] = chosen;
+        nx[lane] = x + (chosen == RIGHT) - (chosen == LEFT);
+        ny[lane] = y + (chosen == UP) - (chosen == DOWN);
+    }
+}
+
+// Bit 0: the move leaves the board. Bit 1: it lands on the apple
+static void check_moves(u32 lanes, i32 width, i32 height, const i32* __restrict nx, const i32* __restrict ny,
+                        const i32* __restrict ax, const i32* __restrict ay, u8* __restrict status) {
+    for (u32 lane = 0; lane < lanes; ++lane) {
+        const i32 wall = (nx[lane] < 0) | (nx[lane] >= width) | (ny[lane] < 0) | (ny[lane] >= height);
+        const i32 apple = (nx[lane] == ax[lane]) & (ny[lane] == ay[lane]);
+        status[lane] = static_cast<u8>(wall | (apple << 1));
+    }
+}
+
+template<typename D>
+LockstepBatch<D>::LockstepBatch(u32 lanes, u64 seed, u64 games_limit, const D& dims)
+    : dims(dims), lanes(lanes), active_count(0), games_started(0), games_limit(games_limit) {
+    for (auto* field : {&head_x, &head_y, &apple_x, &apple_y, &direction, &grow_timer, &next_x, &next_y}) {
+        field->assign(lanes, 0);
+    }
+    free_mask.assign(lanes, 0);
+    active.assign(lanes, 0);
+    status.assign(lanes, 0);
+    rng.resize(lanes);
+    ticks.assign(lanes, 0);
+    last_apple_tick.assign(lanes, 0);
+    length.assign(lanes, 0);
+    boards.assign(usize(lanes) * dims.board_words, 0);
+    bodies.assign(usize(lanes) * dims.cells, 0);
+    body_first.assign(lanes, 0);
+
+    for (u32 lane = 0; lane < lanes; ++lane) {
+        // xorshift32 must not start at 0
+        rng[lane] = static_cast<u32>(derive_seed(seed, lane)) | 1;
+        if (games_started < games_limit)
+            start_game(lane);
+    }
+}
+
+template<typename D>
+void LockstepBatch<D>::start_game(u32 lane) {
+    u64* board = &boards[usize(lane) * dims.board_words];
+    cell_t* body = &bodies[usize(lane) * dims.cells];
+
+    // Empty board, with the padding bits past the width set like Bitboard::clear
+    const u64 padding = (dims.width % 64 == 0) ? 0 : ~u64(0) << (dims.width % 64);
+    for (u32 i = 0; i < dims.board_words; ++i) {
+        board[i] = (i % dims.row_words == dims.row_words - 1) ? padding : 0;
+    }
+
+    const std::array<u16, 2> start = dims.start_position();
+    for (u32 i = 0; i < START_LENGTH; ++i) {
+        const u32 x = start[0] - (START_LENGTH - 1) + i;
+        board[start[1] * dims.row_words + x / 64] |= u64(1) << (x % 64);
+        body[i] = static_cast<cell_t>(dims.cell_index(static_cast<u16>(x), start[1]));
+    }
+    body_first[lane] = 0;
+    length[lane] = START_LENGTH;
+    head_x[lane] = start[0];
+    head_y[lane] = start[1];
+    direction[lane] = START_DIRECTION;
+    grow_timer[lane] = START_GROW_TIMER;
+    ticks[lane] = 0;
+    last_apple_tick[lane] = 0;
+    active[lane] = 1;
+    active_count++;
+    games_started++;
+
+    spawn_apple(lane);
+}
+
+// k-th free tile of the lane's board for a uniform k, a word at a time
+template<typename D>
+void LockstepBatch<D>::spawn_apple(u32 lane) {
+    const u64* board = &boards[usize(lane) * dims.board_words];
+    u32 k = static_cast<u32>((u64(xorshift32(rng[lane])) * (dims.cells - length[lane])) >> 32);
+    for (u32 i = 0; i < dims.board_words; ++i) {
+        u64 free = ~board[i];
+        const u32 count = static_cast<u32>(__builtin_popcountll(free));
+        if (k >= count) {
+            k -= count;
+            continue;
+        }
+        for (; k > 0; --k) {
+            free &= free - 1;
+        }
+        apple_x[lane] = static_cast<i32>((i % dims.row_words) * 64 + __builtin_ctzll(free));
+        apple_y[lane] = static_cast<i32>(i / dims.row_words);
+        return;
+    }
+}
+
+template<typename D>
+void LockstepBatch<D>::finish(u32 lane, DeathCause cause) {
+    results.push_back({length[lane], ticks[lane], cause});
+    active[lane] = 0;
+    active_count--;
+    if (games_started < games_limit)
+        start_game(lane);
+}
+
+template<typename D>
+void LockstepBatch<D>::tick() {
+    const i32 width = dims.width;
+    const i32 height = dims.height;
+    // A local copy, so the compiler knows the stores below can not change the trip count
+    const u32 lanes = this->lanes;
+
+    // ======================== Free neighbors (gather) ======================== //
+
+    for (u32 lane = 0; lane < lanes; ++lane) {
+        const u64* board = &boards[usize(lane) * dims.board_words];
+        const i32 x = head_x[lane];
+        const i32 y = head_y[lane];
+        auto is_free = [&](i32 nx, i32 ny) -> u8 {
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                return 0;
+            return !((board[ny * dims.row_words + nx / 64] >> (nx % 64)) & 1);
+        };
+        free_mask[lane] = static_cast<u8>(is_free(x, y + 1) << UP | is_free(x, y - 1) << DOWN |
+                                          is_free(x - 1, y) << LEFT | is_free(x + 1, y) << RIGHT);
+    }
+
+    // ======================== Decide (vectorized) ======================== //
+
+    decide_lanes(lanes, head_x.data(), head_y.data(), apple_x.data(), apple_y.data(), free_mask.data(),
+                 direction.data(), next_x.data(), next_y.data(), rng.data());
+
+    // ======================== Bounds and apple checks (vectorized) ======================== //
+
+    check_moves(lanes, width, height, next_x.data(), next_y.data(), apple_x.data(), apple_y.data(), status.data());
+    const i32* nx = next_x.data();
+    const i32* ny = next_y.data();
+    const u8* move_status = status.data();
+
+    // ======================== Step (scalar, per-lane memory) ======================== //
+
+    const u32 starvation_limit = starvation_ticks(dims);
+    for (u32 lane = 0; lane < lanes; ++lane) {
+        if (!active[lane])
+            continue;
+        ticks[lane]++;
+        if (move_status[lane] & 1) {
+            finish(lane, DeathCause::WALL);
+            continue;
+        }
+
+        u64* board = &boards[usize(lane) * dims.board_words];
+        cell_t* body = &bodies[usize(lane) * dims.cells];
+        auto wrap = [this](u32 i) { return i >= dims.cells ? i - dims.cells : i; };
+
+        if (grow_timer[lane] != 0)
+            grow_timer[lane]--;
+        else {
+            const std::array<u16, 2> tail = dims.cell_position(body[body_first[lane]]);
+            board[tail[1] * dims.row_words + tail[0] / 64] &= ~(u64(1) << (tail[0] % 64));
+            body_first[lane] = wrap(body_first[lane] + 1);
+            length[lane]--;
+        }
+
+        const u32 x = static_cast<u32>(nx[lane]);
+        const u32 y = static_cast<u32>(ny[lane]);
+        u64& word = board[y * dims.row_words + x / 64];
+        if ((word >> (x % 64)) & 1) {
+            finish(lane, DeathCause::SELF);
+            continue;
+        }
+        word |= u64(1) << (x % 64);
+        body[wrap(body_first[lane] + length[lane])] = static_cast<cell_t>(dims.cell_index(static_cast<u16>(x), static_cast<u16>(y)));
+        length[lane]++;
+        head_x[lane] = nx[lane];
+        head_y[lane] = ny[lane];
+
+        if (move_status[lane] & 2) {
+            grow_timer[lane] += GROW_RATE;
+            last_apple_tick[lane] = ticks[lane];
+            if (length[lane] == dims.cells) {
+                finish(lane, DeathCause::BOARD_FULL);
+                continue;
+            }
+            spawn_apple(lane);
+        }
+        if (ticks[lane] - last_apple_tick[lane] > starvation_limit)
+            finish(lane, DeathCause::STARVED);
+    }
+}
+
+std::vector<GameSummary> run_lockstep_batch(u32 games, u32 threads, u32 lanes, u64 master_seed, u16 width, u16 height) {
+    std::vector<GameSummary> results;
+    results.reserve(games);
+    std::mutex results_mutex;
+    threads = std::max(1u, std::min(threads, games));
+    ThreadPool pool(threads);
+
+    with_board_dims(width, height, [&](auto dims) {
+        using D = decltype(dims);
+        for (u32 t = 0; t < threads; ++t) {
+            const u32 share = games / threads + (t < games % threads);
+            pool.submit([&results, &results_mutex, share, lanes, master_seed, t, dims] {
+                auto batch = std::make_unique<LockstepBatch<D>>(lanes, derive_seed(master_seed, t), share, dims);
+                while (batch->active_count > 0) {
+                    batch->tick();
+                }
+                std::lock_guard<std::mutex> lock(results_mutex);
+                results.insert(results.end(), batch->results.begin(), batch->results.end());
+            });
+        }
+        pool.wait();
+    });
+
+    return results;
+}
+
+#define INSTANTIATE(D) \
+    template struct LockstepBatch<D>;
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,132 @@
+#include "pathctl.h"
+#include "snakectl.h"
+
+template<typename D>
+Pathfinder<D>::Pathfinder(const D& dims) : dims(dims), stamp(0), virtual_board(dims) {
+    queue.resize(dims.cells);
+    parent.resize(dims.cells);
+    visited.resize(dims.cells);
+    path.resize(dims.cells);
+    for (u32 i = 0; i < dims.cells; ++i) {
+        visited[i] = 0;
+    }
+}
+
+// BFS from start to target over the free tiles of board. The target itself may be occupied (e.g. the tail)
+// Writes the path to pathfinder.path and returns its length, or 0 if target can't be reached
+template<typename D>
+static u32 shortest_path(Pathfinder<D>& pf, const Bitboard<D>& board, u32 start, u32 target) {
+    const D& dims = pf.dims;
+    if (++pf.stamp == 0) {
+        // Stamp wrapped around. Old marks could collide with new ones
+        for (u32 i = 0; i < dims.cells; ++i) {
+            pf.visited[i] = 0;
+        }
+        pf.stamp = 1;
+    }
+
+    u32 queue_front = 0;
+    u32 queue_back = 0;
+    pf.queue[queue_back++] = static_cast<typename D::cell_t>(start);
+    pf.visited[start] = pf.stamp;
+
+    while (queue_front < queue_back) {
+        u32 cell = pf.queue[queue_front++];
+        for (u8 dir = 0; dir < 4; ++dir) {
+            u32 next;
+            if (!dims.neighbor_cell(cell, dir, next) || pf.visited[next] == pf.stamp)
+                continue;
+            if (next != target && board.test_cell(next))
+                continue;
+
+            pf.visited[next] = pf.stamp;
+            pf.parent[next] = static_cast<typename D::cell_t>(cell);
+
+            if (next == target) {
+                u32 length = 0;
+                for (u32 c = target; c != start; c = pf.parent[c]) {
+                    length++;
+                }
+                u32 i = length;
+                for (u32 c = target; c != start; c = pf.parent[c]) {
+                    pf.path[--i] = static_cast<typename D::cell_t>(c);
+                }
+                return length;
+            }
+            pf.queue[queue_back++] = static_cast<typename D::cell_t>(next);
+        }
+    }
+    return 0;
+}
+
+// Whether the tail can still be reached after the snake follows the first `length` cells of pathfinder.path
+template<typename D>
+static bool path_is_safe(Pathfinder<D>& pf, const GameState<D>& state, u32 length) {
+    const D& dims = state.dims;
+    const Snake<D>& snake = state.snake;
+    const u32 snake_len = snake.body.size();
+
+    // Growing ticks don't pop the tail (see step)
+    const u32 pops = length > snake.grow_timer ? length - snake.grow_timer : 0;
+
+    pf.virtual_board = state.board;
+    for (u32 i = 0; i < pops && i < snake_len; ++i) {
+        std::array<u16, 2> p = dims.cell_position(snake.body[i]);
+        pf.virtual_board.reset(p[0], p[1]);
+    }
+    for (u32 i = 0; i < length; ++i) {
+        std::array<u16, 2> p = dims.cell_position(pf.path[i]);
+        pf.virtual_board.set(p[0], p[1]);
+    }
+    for (u32 i = snake_len; i < pops; ++i) {
+        std::array<u16, 2> p = dims.cell_position(pf.path[i - snake_len]);
+        pf.virtual_board.reset(p[0], p[1]);
+    }
+
+    const u32 new_head = pf.path[length - 1];
+    const u32 new_tail = pops < snake_len ? snake.body[pops] : pf.path[pops - snake_len];
+    if (new_head == new_tail)
+        return true;
+
+    return shortest_path(pf, pf.virtual_board, new_head, new_tail) > 0;
+}
+
+template<typename D>
+Direction pathfinder_decide(Pathfinder<D>& pf, const GameState<D>& state) {
+    const D& dims = state.dims;
+    const Snake<D>& snake = state.snake;
+    const u32 head = snake.body.back();
+    const u32 tail = snake.body.front();
+    const u32 apple = dims.cell_index(state.apple_position[0], state.apple_position[1]);
+
+    // 1. Shortest path to the apple, if following it keeps the tail in reach
+    // The tail moves out of the way this tick unless the snake is growing
+    pf.virtual_board = state.board;
+    if (snake.grow_timer == 0 && snake.body.size() > 1) {
+        std::array<u16, 2> p = dims.cell_position(tail);
+        pf.virtual_board.reset(p[0], p[1]);
+    }
+
+    u32 length = shortest_path(pf, pf.virtual_board, head, apple);
+    if (length > 0) {
+        Direction first_step = dims.direction_between(head, pf.path[0]);
+        if (path_is_safe(pf, state, length))
+            return first_step;
+    }
+
+    // 2. No safe path to the apple. Follow the tail, which keeps opening up space
+    // Stepping straight onto the tail is only safe if it moves away this tick
+    if (snake.body.size() > 1) {
+        length = shortest_path(pf, state.board, head, tail);
+        if (length > 1 || (length == 1 && snake.grow_timer == 0))
+            return dims.direction_between(head, pf.path[0]);
+    }
+
+    // 3. Boxed in. Let the Blind Snake pick whatever free tile is left
+    return snake_decide(state.apple_position, head_position(state), snake.direction, state.board);
+}
+
+#define INSTANTIATE(D) \
+    template struct Pathfinder<D>; \
+    template Direction pathfinder_decide(Pathfinder<D>&, const GameState<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,163 @@
+#include <mutex>
+
+#include "phase_stats.h"
+
+const char* phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::EVENT_POLL:    return "event_poll";
+        case Phase::DECIDE:        return "decide";
+        case Phase::STEP:          return "step";
+        case Phase::SPAWN_APPLE:   return "spawn_apple";
+        case Phase::RENDER_UPDATE: return "render_update";
+        case Phase::DRAW:          return "draw";
+        case Phase::DISPLAY:       return "display";
+        case Phase::CAPTURE:       return "capture";
+        case Phase::COUNT:         break;
+    }
+    return "unknown";
+}
+
+// Values below SUB_BUCKETS get a bucket each. Above that, the bucket is picked by the position of the highest
+// set bit and the SUB_BUCKETS - 1 bits under it
+static u32 bucket_index(u64 ns) {
+    constexpr u32 SUB_BITS = 2; // log2(SUB_BUCKETS)
+    static_assert(LatencyHistogram::SUB_BUCKETS == 1u << SUB_BITS, "SUB_BITS must match SUB_BUCKETS");
+
+    if (ns < LatencyHistogram::SUB_BUCKETS)
+        return static_cast<u32>(ns);
+    u32 msb = 63 - __builtin_clzll(ns);
+    u32 sub = static_cast<u32>(ns >> (msb - SUB_BITS)) & (LatencyHistogram::SUB_BUCKETS - 1);
+    return (msb - SUB_BITS + 1) * LatencyHistogram::SUB_BUCKETS + sub;
+}
+
+void LatencyHistogram::record(u64 ns) {
+    u32 i = bucket_index(ns);
+    if (i >= BUCKETS)
+        i = BUCKETS - 1;
+    counts[i]++;
+    count++;
+    sum_ns += ns;
+    if (ns > max_ns)
+        max_ns = ns;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (u32 i = 0; i < BUCKETS; ++i)
+        counts[i] += other.counts[i];
+    count += other.count;
+    sum_ns += other.sum_ns;
+    if (other.max_ns > max_ns)
+        max_ns = other.max_ns;
+}
+
+u64 LatencyHistogram::bucket_lower_bound(u32 i) {
+    if (i < SUB_BUCKETS)
+        return i;
+    u32 octave = i / SUB_BUCKETS - 1;
+    u32 sub = i % SUB_BUCKETS;
+    return u64(SUB_BUCKETS + sub) << octave;
+}
+
+u64 LatencyHistogram::percentile(double p) const {
+    if (count == 0)
+        return 0;
+    // Nearest rank
+    u64 rank = static_cast<u64>(p * count + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    u64 seen = 0;
+    for (u32 i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= rank)
+            return bucket_lower_bound(i);
+    }
+    return max_ns;
+}
+
+void PhaseStats::merge(const PhaseStats& other) {
+    for (usize p = 0; p < phases.size(); ++p)
+        phases[p].merge(other.phases[p]);
+}
+
+// A thread's histograms, linked into a list of every running thread's, so registering one never allocates
+// When the thread exits its samples move into retired_stats
+struct ThreadPhaseStats {
+    PhaseStats stats;
+    ThreadPhaseStats* prev;
+    ThreadPhaseStats* next;
+
+    ThreadPhaseStats();
+    ~ThreadPhaseStats();
+};
+
+// Trivially destructible, so they outlive every thread's ThreadPhaseStats whatever the exit order
+static std::mutex registry_mutex;
+static ThreadPhaseStats* registry_head = nullptr;
+static PhaseStats retired_stats;
+
+ThreadPhaseStats::ThreadPhaseStats() : prev(nullptr) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    next = registry_head;
+    if (next != nullptr)
+        next->prev = this;
+    registry_head = this;
+}
+
+ThreadPhaseStats::~ThreadPhaseStats() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    retired_stats.merge(stats);
+    (prev != nullptr ? prev->next : registry_head) = next;
+    if (next != nullptr)
+        next->prev = prev;
+}
+
+PhaseStats& thread_phase_stats() {
+    thread_local ThreadPhaseStats thread_stats;
+    return thread_stats.stats;
+}
+
+PhaseStats merged_phase_stats() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    PhaseStats merged = retired_stats;
+    for (const ThreadPhaseStats* thread_stats = registry_head; thread_stats != nullptr; thread_stats = thread_stats->next)
+        merged.merge(thread_stats->stats);
+    return merged;
+}
+
+void write_phase_stats_json(std::ostream& out, const PhaseStats& stats) {
+    out << "{\n  \"phases\": {";
+    for (u8 p = 0; p < static_cast<u8>(Phase::COUNT); ++p) {
+        const LatencyHistogram& h = stats[static_cast<Phase>(p)];
+        out << (p == 0 ? "\n" : ",\n");
+        out << "    \"" << phase_name(static_cast<Phase>(p)) << "\": {"
+            << "\"count\": " << h.count
+            << ", \"mean_ns\": " << (h.count > 0 ? double(h.sum_ns) / h.count : 0.0)
+            << ", \"p50_ns\": " << h.percentile(0.5)
+            << ", \"p90_ns\": " << h.percentile(0.9)
+            << ", \"p99_ns\": " << h.percentile(0.99)
+            << ", \"max_ns\": " << h.max_ns
+            << ", \"buckets\": [";
+        bool first = true;
+        for (u32 i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+            if (h.counts[i] == 0)
+                continue;
+            out << (first ? "" : ", ") << "[" << LatencyHistogram::bucket_lower_bound(i) << ", " << h.counts[i] << "]";
+            first = false;
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}\n";
+}
+
+void write_phase_stats_csv(std::ostream& out, const PhaseStats& stats) {
+    out << "phase,lower_ns,upper_ns,count\n";
+    for (u8 p = 0; p < static_cast<u8>(Phase::COUNT); ++p) {
+        const LatencyHistogram& h = stats[static_cast<Phase>(p)];
+        for (u32 i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+            if (h.counts[i] == 0)
+                continue;
+            u64 upper = (i + 1 < LatencyHistogram::BUCKETS) ? LatencyHistogram::bucket_lower_bound(i + 1) : h.max_ns + 1;
+            out << phase_name(static_cast<Phase>(p)) << ',' << LatencyHistogram::bucket_lower_bound(i) << ',' << upper << ',' << h.counts[i] << '\n';
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#include "player_input.h"
+
+bool PressQueue::push(const DirectionPress& press) {
+    const u32 position = tail.load(std::memory_order_relaxed);
+    if (position - head.load(std::memory_order_acquire) == CAPACITY)
+        return false;
+    slots[position & (CAPACITY - 1)] = press;
+    tail.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool PressQueue::pop(DirectionPress& press) {
+    const u32 position = head.load(std::memory_order_relaxed);
+    if (position == tail.load(std::memory_order_acquire))
+        return false;
+    press = slots[position & (CAPACITY - 1)];
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+void PlayerInput::press(Direction direction, u64 pressed_ns) {
+    counters.presses++;
+    if (direction == last_queued || is_reversal(direction, last_queued)) {
+        counters.rejected++;
+        return;
+    }
+    if (!queue.push(DirectionPress{direction, pressed_ns})) {
+        counters.dropped++;
+        return;
+    }
+    last_queued = direction;
+}
+
+void PlayerInput::reset() {
+    DirectionPress press;
+    while (queue.pop(press)) {
+        counters.discarded++;
+    }
+    last_queued = START_DIRECTION;
+}
+
+template<typename D>
+Direction PlayerInput::decide(const GameState<D>& state) {
+    const Direction current = state.snake.direction;
+    DirectionPress press;
+    if (!queue.pop(press))
+        return current;
+    // The producer already checked the press against the one queued before it, which is the current direction now
+    counters.applied++;
+    counters.latency_us.push_back((steady_now_ns() - press.pressed_ns) / 1000.0);
+    return press.direction;
+}
+
+#define INSTANTIATE(D) \
+    template Direction PlayerInput::decide(const GameState<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
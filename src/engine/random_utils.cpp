@@ -9,8 +9,8 @@ static constexpr uint32_t compile_time_seed =
 
 // ============================================================ //
 
-std::mt19937& get_rng() {
-    static std::mt19937 rng(std::random_device{}());
+Xoshiro256& get_rng() {
+    thread_local Xoshiro256 rng((u64(std::random_device{}()) << 32) | std::random_device{}());
     return rng;
 }
 
@@ -18,3 +18,14 @@ std::mt19937& get_rng_seeded() {
     static std::mt19937 rng(compile_time_seed);
     return rng;
 }
+
+void seed_rng(u64 seed) {
+    get_rng().seed(seed);
+}
+
+u64 derive_seed(u64 master_seed, u64 stream) {
+    u64 z = master_seed + (stream + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
@@ -0,0 +1,300 @@
+#include "reachability.h"
+
+// Region ids are < dims.cells, and D::cell_t always leaves room for OCCUPIED and one more sentinel above that
+
+template<typename D>
+Reachability<D>::Reachability(const D& dims)
+    : dims(dims), unused_count(0), stamp(0), synced_ticks(0), synced_head(0), synced_tail(0), synced(false) {
+    label.resize(dims.cells);
+    region_size.resize(dims.cells);
+    unused_ids.resize(dims.cells);
+    for (auto& queue : queues) {
+        queue.resize(dims.cells);
+    }
+    visited.resize(dims.cells);
+    for (u32 i = 0; i < dims.cells; ++i) {
+        label[i] = OCCUPIED;
+        visited[i] = 0;
+    }
+}
+
+template<typename D>
+typename D::cell_t Reachability<D>::new_region() {
+    return unused_ids[--unused_count];
+}
+
+// BFS over the region containing start, moving every tile of it to region id. Returns the number of tiles
+template<typename D>
+u32 Reachability<D>::relabel(u32 start, cell_t id) {
+    auto& queue = queues[0];
+    const cell_t old_id = label[start];
+    u32 front = 0, back = 0;
+    queue[back++] = static_cast<cell_t>(start);
+    label[start] = id;
+
+    while (front < back) {
+        u32 cell = queue[front++];
+        for (u8 dir = 0; dir < 4; ++dir) {
+            u32 next;
+            if (dims.neighbor_cell(cell, dir, next) && label[next] == old_id) {
+                label[next] = id;
+                queue[back++] = static_cast<cell_t>(next);
+            }
+        }
+    }
+    return back;
+}
+
+template<typename D>
+void Reachability<D>::rebuild(const Bitboard<D>& board) {
+    // Every id is unused, handed out lowest first
+    unused_count = 0;
+    for (u32 i = dims.cells; i > 0; --i) {
+        unused_ids[unused_count++] = static_cast<cell_t>(i - 1);
+    }
+
+    // Free tiles start out with a placeholder label that no region uses yet
+    const cell_t unlabeled = OCCUPIED - 1;
+    for (u32 cell = 0; cell < dims.cells; ++cell) {
+        label[cell] = board.test_cell(cell) ? OCCUPIED : unlabeled;
+    }
+
+    for (u32 cell = 0; cell < dims.cells; ++cell) {
+        if (label[cell] != unlabeled)
+            continue;
+        cell_t id = new_region();
+        region_size[id] = relabel(cell, id);
+    }
+    synced = false;
+}
+
+template<typename D>
+void Reachability<D>::free_cell(u32 cell) {
+    // Regions around the cell, which it now joins together
+    u32 neighbors[4];
+    cell_t ids[4];
+    u8 count = 0;
+    for (u8 dir = 0; dir < 4; ++dir) {
+        u32 next;
+        if (!dims.neighbor_cell(cell, dir, next) || label[next] == OCCUPIED)
+            continue;
+        bool seen = false;
+        for (u8 i = 0; i < count; ++i) {
+            seen |= (ids[i] == label[next]);
+        }
+        if (!seen) {
+            neighbors[count] = next;
+            ids[count] = label[next];
+            count++;
+        }
+    }
+
+    if (count == 0) {
+        cell_t id = new_region();
+        label[cell] = id;
+        region_size[id] = 1;
+        return;
+    }
+
+    // Merge everything into the largest region, so only the smaller ones get relabeled
+    u8 largest = 0;
+    for (u8 i = 1; i < count; ++i) {
+        if (region_size[ids[i]] > region_size[ids[largest]])
+            largest = i;
+    }
+    const cell_t keep = ids[largest];
+    for (u8 i = 0; i < count; ++i) {
+        if (i == largest)
+            continue;
+        region_size[keep] += region_size[ids[i]];
+        relabel(neighbors[i], keep);
+        unused_ids[unused_count++] = ids[i];
+    }
+
+    label[cell] = keep;
+    region_size[keep]++;
+}
+
+// Whether the free orthogonal neighbors of cell are still connected to each other without cell,
+// judging only by the 8 tiles around it. True means no split; false means there might be one
+template<typename D>
+bool Reachability<D>::locally_connected(u32 cell) const {
+    // Clockwise from UP (y + 1). Even entries are the orthogonal neighbors
+    static constexpr int dx[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+    static constexpr int dy[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+
+    std::array<u16, 2> p = dims.cell_position(cell);
+    bool free[8];
+    u8 free_count = 0;
+    for (u8 i = 0; i < 8; ++i) {
+        int x = p[0] + dx[i];
+        int y = p[1] + dy[i];
+        free[i] = x >= 0 && y >= 0 && x < dims.width && y < dims.height &&
+                  label[dims.cell_index(static_cast<u16>(x), static_cast<u16>(y))] != OCCUPIED;
+        free_count += free[i];
+    }
+    if (free_count == 8)
+        return true;
+
+    // Count the runs of free tiles around the ring that contain an orthogonal neighbor
+    u8 runs = 0;
+    for (u8 i = 0; i < 8; ++i) {
+        if (!free[i] || free[(i + 7) % 8])
+            continue;
+        bool has_orthogonal = false;
+        for (u8 j = i; free[j % 8] && j < i + 8; ++j) {
+            has_orthogonal |= (j % 2 == 0);
+        }
+        runs += has_orthogonal;
+    }
+    return runs <= 1;
+}
+
+template<typename D>
+void Reachability<D>::occupy_cell(u32 cell) {
+    const cell_t id = label[cell];
+    label[cell] = OCCUPIED;
+    region_size[id]--;
+
+    u32 neighbors[4];
+    u8 count = 0;
+    for (u8 dir = 0; dir < 4; ++dir) {
+        u32 next;
+        if (dims.neighbor_cell(cell, dir, next) && label[next] != OCCUPIED)
+            neighbors[count++] = next;
+    }
+
+    if (count == 0) {
+        // That was the last tile of the region
+        unused_ids[unused_count++] = id;
+        return;
+    }
+    if (count == 1 || locally_connected(cell))
+        return;
+
+    // The region may have split. Search from every neighbor in lockstep. Searches that meet join the same group.
+    // A group whose searches all run dry without meeting the rest is a separate piece and gets a new id.
+    // This stops as soon as one group is left, so the largest piece is never walked in full
+    if (++stamp >= (1u << 30)) {
+        for (u32 i = 0; i < dims.cells; ++i) {
+            visited[i] = 0;
+        }
+        stamp = 1;
+    }
+    const u32 base = stamp * 4;
+
+    u32 front[4], back[4];
+    u8 group[4]; // Union-find over the searches
+    bool done[4];
+    for (u8 i = 0; i < count; ++i) {
+        queues[i][0] = static_cast<cell_t>(neighbors[i]);
+        front[i] = 0;
+        back[i] = 1;
+        group[i] = i;
+        done[i] = false;
+        visited[neighbors[i]] = base + i;
+    }
+    auto find = [&group](u8 i) {
+        while (group[i] != i) {
+            i = group[i];
+        }
+        return i;
+    };
+
+    u8 active_groups = count;
+    while (active_groups > 1) {
+        for (u8 i = 0; i < count && active_groups > 1; ++i) {
+            if (front[i] == back[i])
+                continue;
+
+            u32 current = queues[i][front[i]++];
+            for (u8 dir = 0; dir < 4; ++dir) {
+                u32 next;
+                if (!dims.neighbor_cell(current, dir, next) || label[next] == OCCUPIED)
+                    continue;
+                if (visited[next] >= base) {
+                    u8 a = find(i);
+                    u8 b = find(static_cast<u8>(visited[next] - base));
+                    if (a != b) {
+                        group[b] = a;
+                        active_groups--;
+                    }
+                    continue;
+                }
+                visited[next] = base + i;
+                queues[i][back[i]++] = static_cast<cell_t>(next);
+            }
+
+            // Is this search's whole group out of tiles?
+            u8 g = find(i);
+            if (done[g])
+                continue;
+            bool exhausted = true;
+            for (u8 j = 0; j < count; ++j) {
+                if (find(j) == g && front[j] != back[j])
+                    exhausted = false;
+            }
+            if (!exhausted)
+                continue;
+
+            // Separate piece: everything its searches visited moves to a new region
+            cell_t piece = new_region();
+            u32 size = 0;
+            for (u8 j = 0; j < count; ++j) {
+                if (find(j) != g)
+                    continue;
+                for (u32 k = 0; k < back[j]; ++k) {
+                    label[queues[j][k]] = piece;
+                }
+                size += back[j];
+            }
+            region_size[piece] = size;
+            region_size[id] -= size;
+            done[g] = true;
+            active_groups--;
+        }
+    }
+}
+
+template<typename D>
+void Reachability<D>::sync(const GameState<D>& state) {
+    const u32 head = state.snake.body.back();
+    const u32 tail = state.snake.body.front();
+
+    if (synced && state.ticks == synced_ticks && head == synced_head && tail == synced_tail)
+        return;
+
+    u32 neighbor;
+    bool one_tick_later = synced && state.ticks == synced_ticks + 1;
+    bool head_moved_one_tile = false;
+    for (u8 dir = 0; dir < 4; ++dir) {
+        head_moved_one_tile |= dims.neighbor_cell(synced_head, dir, neighbor) && neighbor == head;
+    }
+
+    if (one_tick_later && head_moved_one_tile) {
+        // Same order as step: the tail leaves before the head arrives
+        if (tail != synced_tail)
+            free_cell(synced_tail);
+        occupy_cell(head);
+    }
+    else {
+        rebuild(state.board);
+    }
+
+    synced_ticks = state.ticks;
+    synced_head = head;
+    synced_tail = tail;
+    synced = true;
+}
+
+template<typename D>
+u32 Reachability<D>::reachable_after_move(u32 head, Direction dir) const {
+    u32 next;
+    if (!dims.neighbor_cell(head, dir, next) || label[next] == OCCUPIED)
+        return 0;
+    return region_size[label[next]];
+}
+
+#define INSTANTIATE(D) \
+    template struct Reachability<D>;
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
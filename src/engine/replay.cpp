@@ -0,0 +1,403 @@
+#include "replay.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "random_utils.h"
+
+// Headers, counts and apple cells are copied in and out of the byte stream as they are in memory,
+// which is little-endian on every platform this builds for
+
+template<typename T>
+static T load(const u8* bytes) {
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+template<typename T>
+static void append(std::vector<u8>& bytes, const T* values, usize count) {
+    const u8* begin = reinterpret_cast<const u8*>(values);
+    bytes.insert(bytes.end(), begin, begin + count * sizeof(T));
+}
+
+// ============================================================ //
+// Writing
+
+BufferedFileWriter::BufferedFileWriter(const std::string& path) : path(path), closing(false), write_failed(false) {
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        throw(std::runtime_error("Could not open " + path + " for writing"));
+    worker = std::thread(&BufferedFileWriter::run, this);
+}
+
+BufferedFileWriter::~BufferedFileWriter() {
+    try {
+        close();
+    } catch (const std::runtime_error&) {
+        // Whoever wanted to know called close() first
+    }
+}
+
+void BufferedFileWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closing)
+            return;
+        closing = true;
+    }
+    work_available.notify_one();
+    worker.join();
+    // fclose writes out what stdio still buffers, so it can fail too
+    const bool closed = std::fclose(file) == 0;
+    if (write_failed || !closed)
+        throw(std::runtime_error("Could not write " + path + ", so it is incomplete"));
+}
+
+bool BufferedFileWriter::failed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return write_failed;
+}
+
+std::vector<u8> BufferedFileWriter::take_buffer() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_buffers.empty())
+        return {};
+    std::vector<u8> buffer = std::move(free_buffers.back());
+    free_buffers.pop_back();
+    return buffer;
+}
+
+void BufferedFileWriter::write(std::vector<u8>&& bytes) {
+    write_at(APPEND, std::move(bytes));
+}
+
+void BufferedFileWriter::write_at(u64 offset, std::vector<u8>&& bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({offset, std::move(bytes)});
+    }
+    work_available.notify_one();
+}
+
+void BufferedFileWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_available.wait(lock, [this] { return closing || !queue.empty(); });
+        if (queue.empty())
+            return; // Closing and nothing left
+
+        Block block = std::move(queue.front());
+        queue.pop_front();
+        const bool skip = write_failed;
+        lock.unlock();
+
+        // fseeko, since offsets past 2 GB do not fit the long of fseek everywhere
+        bool written = !skip;
+        if (written && block.offset != APPEND)
+            written = ::fseeko(file, static_cast<off_t>(block.offset), SEEK_SET) == 0;
+        if (written)
+            written = std::fwrite(block.bytes.data(), 1, block.bytes.size(), file) == block.bytes.size();
+        if (written && block.offset != APPEND)
+            written = ::fseeko(file, 0, SEEK_END) == 0;
+
+        block.bytes.clear();
+        lock.lock();
+        write_failed = !written;
+        free_buffers.push_back(std::move(block.bytes));
+    }
+}
+
+ReplayRecorder::ReplayRecorder(const std::string& path)
+    : writer(path), header{}, header_offset(0), file_size(0), chunk_ticks(0) {
+    moves.reserve(CHUNK_TICKS / 4);
+}
+
+void ReplayRecorder::begin_game(u16 width, u16 height, ControllerKind controller_kind, u64 seed, u32 tick_rate) {
+    header = ReplayHeader{};
+    std::memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    header.version = REPLAY_VERSION;
+    header.width = width;
+    header.height = height;
+    header.controller_kind = static_cast<u8>(controller_kind);
+    header.seed = seed;
+    header.tick_rate = tick_rate;
+
+    // Placeholder until end_game knows the totals
+    header_offset = file_size;
+    std::vector<u8> bytes = writer.take_buffer();
+    append(bytes, &header, 1);
+    file_size += bytes.size();
+    writer.write(std::move(bytes));
+
+    chunk_ticks = 0;
+    moves.clear();
+    apples.clear();
+}
+
+void ReplayRecorder::flush_chunk() {
+    std::vector<u8> bytes = writer.take_buffer();
+    const u32 apple_count = static_cast<u32>(apples.size());
+    append(bytes, &chunk_ticks, 1);
+    append(bytes, &apple_count, 1);
+    append(bytes, moves.data(), moves.size());
+    append(bytes, apples.data(), apples.size());
+    file_size += bytes.size();
+    writer.write(std::move(bytes));
+
+    chunk_ticks = 0;
+    moves.clear();
+    apples.clear();
+}
+
+void ReplayRecorder::end_game(u32 final_length, DeathCause death_cause) {
+    if (writer.failed())
+        throw(std::runtime_error("A replay write failed, so the recording is incomplete"));
+    if (chunk_ticks != 0 || !apples.empty())
+        flush_chunk();
+
+    header.final_length = final_length;
+    header.death_cause = static_cast<u8>(death_cause);
+    header.record_bytes = file_size - header_offset;
+    std::vector<u8> bytes = writer.take_buffer();
+    append(bytes, &header, 1);
+    writer.write_at(header_offset, std::move(bytes));
+}
+
+// ============================================================ //
+// Reading
+
+MappedFile::MappedFile(const std::string& path, bool sequential) : bytes(nullptr), length(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw(std::runtime_error("Could not open " + path));
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw(std::runtime_error("Could not read the size of " + path));
+    }
+    length = static_cast<usize>(info.st_size);
+    if (length > 0) {
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw(std::runtime_error("Could not map " + path));
+        }
+        if (sequential)
+            ::madvise(mapped, length, MADV_SEQUENTIAL);
+        bytes = static_cast<const u8*>(mapped);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (bytes != nullptr)
+        ::munmap(const_cast<u8*>(bytes), length);
+}
+
+// Bytes taken by a chunk that records ticks moves and apple_count apples, counts included
+static u64 chunk_size(u32 ticks, u32 apple_count) {
+    return 2 * sizeof(u32) + (u64(ticks) + 3) / 4 + u64(apple_count) * sizeof(u32);
+}
+
+std::vector<ReplayGame> read_replay_games(const MappedFile& file) {
+    std::vector<ReplayGame> games;
+    const u8* position = file.data();
+    const u8* end = file.data() + file.size();
+
+    while (position != end) {
+        const usize offset = static_cast<usize>(position - file.data());
+        if (static_cast<usize>(end - position) < sizeof(ReplayHeader))
+            throw(std::runtime_error("Replay is cut off at byte " + std::to_string(offset)));
+
+        ReplayGame game;
+        game.header = load<ReplayHeader>(position);
+        const ReplayHeader& header = game.header;
+        if (std::memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0)
+            throw(std::runtime_error("Not a replay file (no game header at byte " + std::to_string(offset) + ")"));
+        if (header.version != REPLAY_VERSION)
+            throw(std::runtime_error("Unsupported replay version " + std::to_string(header.version)));
+        if (header.width < 2 || header.height < 2 || header.width > MAX_BOARD_LENGTH || header.height > MAX_BOARD_LENGTH)
+            throw(std::runtime_error("Replay has an invalid board size"));
+        if (header.controller_kind > static_cast<u8>(ControllerKind::PLAYER))
+            throw(std::runtime_error("Replay has an unknown controller"));
+        if (header.record_bytes < sizeof(ReplayHeader) || header.record_bytes > static_cast<u64>(end - position))
+            throw(std::runtime_error("Replay is cut off at byte " + std::to_string(offset)));
+
+        game.chunks = position + sizeof(ReplayHeader);
+        game.chunks_size = static_cast<usize>(header.record_bytes - sizeof(ReplayHeader));
+
+        // The chunks must add up to the header's totals. Only reads the counts, not the moves
+        u64 ticks = 0, apples = 0;
+        const u8* chunk = game.chunks;
+        const u8* chunks_end = game.chunks + game.chunks_size;
+        while (chunk != chunks_end) {
+            if (static_cast<usize>(chunks_end - chunk) < 2 * sizeof(u32))
+                throw(std::runtime_error("Replay has a broken chunk"));
+            const u32 chunk_ticks = load<u32>(chunk);
+            const u32 chunk_apples = load<u32>(chunk + sizeof(u32));
+            const u64 size = chunk_size(chunk_ticks, chunk_apples);
+            if (size > static_cast<u64>(chunks_end - chunk))
+                throw(std::runtime_error("Replay has a broken chunk"));
+            ticks += chunk_ticks;
+            apples += chunk_apples;
+            chunk += size;
+        }
+        if (ticks != header.ticks || apples != header.apples)
+            throw(std::runtime_error("Replay chunks do not match their game header"));
+
+        games.push_back(game);
+        position += header.record_bytes;
+    }
+    return games;
+}
+
+ReplayCursor::ReplayCursor(const ReplayGame& game) : end(game.chunks + game.chunks_size) {
+    move_walk = ChunkWalk{game.chunks, nullptr, nullptr, 0, 0, 0};
+    apple_walk = move_walk;
+}
+
+bool ReplayCursor::ChunkWalk::advance(const u8* end) {
+    if (next_chunk == end)
+        return false;
+    ticks = load<u32>(next_chunk);
+    apple_count = load<u32>(next_chunk + sizeof(u32));
+    moves = next_chunk + 2 * sizeof(u32);
+    apples = moves + (ticks + 3) / 4;
+    next_chunk += chunk_size(ticks, apple_count);
+    index = 0;
+    return true;
+}
+
+bool ReplayCursor::next_move(Direction& direction) {
+    while (move_walk.index == move_walk.ticks) {
+        if (!move_walk.advance(end))
+            return false;
+    }
+    const u32 i = move_walk.index++;
+    direction = static_cast<Direction>((move_walk.moves[i / 4] >> (2 * (i % 4))) & 3);
+    return true;
+}
+
+bool ReplayCursor::next_apple(u32& cell) {
+    while (apple_walk.index == apple_walk.apple_count) {
+        if (!apple_walk.advance(end))
+            return false;
+    }
+    cell = load<u32>(apple_walk.apples + sizeof(u32) * apple_walk.index++);
+    return true;
+}
+
+// ============================================================ //
+// Playback
+
+template<typename D>
+void start_playback(GameState<D>& state, ReplayCursor& cursor) {
+    init_game(state);
+    u32 cell;
+    if (cursor.next_apple(cell) && cell < state.dims.cells)
+        state.apple_position = state.dims.cell_position(cell);
+}
+
+template<typename D>
+bool playback_step(GameState<D>& state, ReplayCursor& cursor, StepEvents* events) {
+    Direction direction;
+    if (!cursor.next_move(direction))
+        return false;
+
+    StepEvents local_events;
+    StepEvents& step_events = events != nullptr ? *events : local_events;
+    const bool alive = step(state, direction, &step_events);
+
+    // step drew its own apple. Put the recorded one in its place
+    u32 cell;
+    if (step_events.apple_spawned && cursor.next_apple(cell) && cell < state.dims.cells)
+        state.apple_position = state.dims.cell_position(cell);
+    return alive;
+}
+
+// ============================================================ //
+// Verification
+
+template<typename D>
+static ReplayVerification verify_game(const D& dims, const ReplayGame& game) {
+    const ReplayHeader& header = game.header;
+    if (static_cast<ControllerKind>(header.controller_kind) == ControllerKind::ROLLOUT)
+        return ReplayVerification{false, 0, "rollout games depend on timing and can not be re-simulated"};
+    if (static_cast<ControllerKind>(header.controller_kind) == ControllerKind::PLAYER)
+        return ReplayVerification{false, 0, "player games depend on the keyboard and can not be re-simulated"};
+    auto state_ptr = std::make_unique<GameState<D>>(dims);
+    GameState<D>& state = *state_ptr;
+    Controller<D> controller(static_cast<ControllerKind>(header.controller_kind), dims);
+    ReplayCursor cursor(game);
+
+    auto fail = [&state](const std::string& problem) {
+        return ReplayVerification{false, state.ticks, "tick " + std::to_string(state.ticks) + ": " + problem};
+    };
+    auto check_apple = [&](const char* which) {
+        u32 recorded;
+        if (!cursor.next_apple(recorded))
+            return std::string(which) + " apple is missing from the recording";
+        const u32 actual = dims.cell_index(state.apple_position[0], state.apple_position[1]);
+        if (recorded != actual)
+            return std::string(which) + " apple is on cell " + std::to_string(actual) + ", recorded on " + std::to_string(recorded);
+        return std::string();
+    };
+
+    seed_rng(header.seed);
+    init_game(state);
+    std::string problem = check_apple("first");
+    if (!problem.empty())
+        return fail(problem);
+
+    // Games that end by dying do so on their last recorded tick. The others (starved, or the window was closed)
+    // are still alive after it
+    const DeathCause recorded_cause = static_cast<DeathCause>(header.death_cause);
+    const bool died = recorded_cause == DeathCause::WALL || recorded_cause == DeathCause::SELF ||
+                      recorded_cause == DeathCause::BOARD_FULL;
+
+    for (u64 tick = 0; tick < header.ticks; ++tick) {
+        Direction recorded;
+        if (!cursor.next_move(recorded))
+            return fail("recording ends at tick " + std::to_string(tick) + " of " + std::to_string(header.ticks));
+        const Direction decided = controller.decide(state);
+        if (decided != recorded)
+            return fail("controller moved " + std::to_string(decided) + ", recorded " + std::to_string(recorded));
+
+        StepEvents events;
+        const bool alive = step(state, decided, &events);
+        if (events.apple_spawned) {
+            problem = check_apple("spawned");
+            if (!problem.empty())
+                return fail(problem);
+        }
+        const bool last = tick + 1 == header.ticks;
+        if (!alive && !(last && died))
+            return fail(std::string("snake died (") + death_cause_name(state.death_cause) + ") before the recording ended");
+        if (alive && last && died)
+            return fail("snake is still alive at the end of the recording");
+    }
+
+    if (died && state.death_cause != recorded_cause)
+        return fail(std::string("died of ") + death_cause_name(state.death_cause) + ", recorded " + death_cause_name(recorded_cause));
+    if (snake_length(state) != header.final_length)
+        return fail("final length is " + std::to_string(snake_length(state)) + ", recorded " + std::to_string(header.final_length));
+    return ReplayVerification{true, state.ticks, ""};
+}
+
+ReplayVerification verify_replay(const ReplayGame& game) {
+    return with_board_dims(game.header.width, game.header.height, [&game](auto dims) {
+        return verify_game(dims, game);
+    });
+}
+
+#define INSTANTIATE(D) \
+    template void start_playback(GameState<D>&, ReplayCursor&); \
+    template bool playback_step(GameState<D>&, ReplayCursor&, StepEvents*);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,134 @@
+#include <chrono>
+
+#include "rolloutctl.h"
+#include "random_utils.h"
+#include "snakectl.h"
+
+using rollout_clock = std::chrono::steady_clock;
+
+// A rollout scores the ticks it survived plus this much per apple eaten, minus options.depth if the snake died
+static constexpr double APPLE_SCORE = 16;
+
+template<typename D>
+RolloutPlanner<D>::RolloutPlanner(const RolloutOptions& options, const D& dims)
+    : dims(dims), options(options), seed((u64(std::random_device{}()) << 32) | std::random_device{}()), decisions(0), rollouts(0), busy_seconds(0) {
+    if (this->options.threads == 0)
+        this->options.threads = 1;
+    if (this->options.threads > 1)
+        pool = std::make_unique<ThreadPool>(this->options.threads);
+    for (u32 i = 0; i < this->options.threads; ++i) {
+        scratch.push_back(std::make_unique<CompactState<D>>(dims));
+    }
+    tallies.resize(this->options.threads);
+    root = std::make_unique<CompactState<D>>(dims);
+}
+
+// Plays move and then depth - 1 Blind Snake moves on fork
+template<typename D>
+static double rollout(CompactState<D>& fork, Direction move, u32 depth) {
+    u32 survived = 0;
+    u32 apples = 0;
+    Direction direction = move;
+    while (survived < depth) {
+        const bool alive = step(fork, direction);
+        if (fork.last_apple_tick == fork.ticks)
+            apples++;
+        if (!alive) {
+            if (fork.death_cause == DeathCause::BOARD_FULL)
+                return depth + APPLE_SCORE * apples;
+            return survived + APPLE_SCORE * apples - depth;
+        }
+        survived++;
+        direction = snake_decide(apple_position(fork), head_position(fork), fork.direction, fork.board);
+    }
+    return survived + APPLE_SCORE * apples;
+}
+
+// One worker's share of a decision: rollouts round-robin over the moves until the deadline
+template<typename D>
+static void run_rollouts(RolloutPlanner<D>& planner, u32 worker, const Direction* moves, u32 move_count,
+                         rollout_clock::time_point deadline) {
+    CompactState<D>& fork = *planner.scratch[worker];
+    RolloutTally& tally = planner.tallies[worker];
+    tally = RolloutTally{};
+
+    // snake_decide and spawn_apple draw from the thread's generator. Point it at this worker's stream and put
+    // the game's own stream back afterwards
+    Xoshiro256& rng = get_rng();
+    const Xoshiro256 saved = rng;
+    rng.seed(derive_seed(planner.seed, planner.decisions * planner.options.threads + worker));
+
+    // Every move gets at least one rollout, however short the budget
+    for (u64 i = 0; i < move_count || rollout_clock::now() < deadline; ++i) {
+        const Direction move = moves[(worker + i) % move_count];
+        fork = *planner.root;
+        tally.score[move] += rollout(fork, move, planner.options.depth);
+        tally.count[move]++;
+        tally.rollouts++;
+    }
+
+    rng = saved;
+}
+
+template<typename D>
+Direction rollout_decide(RolloutPlanner<D>& planner, const GameState<D>& state) {
+    const rollout_clock::time_point start = rollout_clock::now();
+    const rollout_clock::time_point deadline = start + std::chrono::microseconds(planner.options.budget_us);
+
+    const std::array<u16, 2> head = head_position(state);
+    const u8 free_directions = state.board.free_neighbors(head[0], head[1]);
+    Direction moves[4];
+    u32 move_count = 0;
+    for (u8 dir = 0; dir < 4; ++dir) {
+        if (free_directions & (1 << dir))
+            moves[move_count++] = static_cast<Direction>(dir);
+    }
+    // Nothing to compare. With no free move the snake dies whatever it does
+    if (move_count == 0)
+        return snake_decide(state.apple_position, head, state.snake.direction, state.board);
+    if (move_count == 1)
+        return moves[0];
+
+    compact_state(state, *planner.root);
+    if (planner.pool != nullptr) {
+        for (u32 worker = 0; worker < planner.options.threads; ++worker) {
+            planner.pool->submit([&planner, worker, &moves, move_count, deadline] {
+                run_rollouts(planner, worker, moves, move_count, deadline);
+            });
+        }
+        planner.pool->wait();
+    }
+    else {
+        run_rollouts(planner, 0, moves, move_count, deadline);
+    }
+
+    // Best mean score. Ties keep the current direction, then go to the first move found
+    double score[4] = {};
+    u32 count[4] = {};
+    for (const RolloutTally& tally : planner.tallies) {
+        for (u8 dir = 0; dir < 4; ++dir) {
+            score[dir] += tally.score[dir];
+            count[dir] += tally.count[dir];
+        }
+        planner.rollouts += tally.rollouts;
+    }
+    Direction best = moves[0];
+    double best_mean = -1e300;
+    for (u32 i = 0; i < move_count; ++i) {
+        const Direction dir = moves[i];
+        const double mean = count[dir] > 0 ? score[dir] / count[dir] : -1e300;
+        if (mean > best_mean || (mean == best_mean && dir == state.snake.direction)) {
+            best = dir;
+            best_mean = mean;
+        }
+    }
+
+    planner.decisions++;
+    planner.busy_seconds += std::chrono::duration<double>(rollout_clock::now() - start).count();
+    return best;
+}
+
+#define INSTANTIATE(D) \
+    template struct RolloutPlanner<D>; \
+    template Direction rollout_decide(RolloutPlanner<D>&, const GameState<D>&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
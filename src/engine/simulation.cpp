@@ -0,0 +1,41 @@
+#include "simulation.h"
+#include "phase_stats.h"
+
+template<typename D>
+GameSummary run_headless_game(GameState<D>& state, Controller<D>& controller, ReplayRecorder* recorder) {
+    init_game(state);
+    const u32 starvation_limit = starvation_ticks(state.dims);
+    if (recorder != nullptr)
+        recorder->record_apple(state.dims.cell_index(state.apple_position[0], state.apple_position[1]));
+
+    while (true) {
+        Direction dir;
+        bool alive;
+        {
+            SNAKE_TIME_PHASE(Phase::DECIDE);
+            dir = controller.decide(state);
+        }
+        StepEvents events;
+        {
+            SNAKE_TIME_PHASE(Phase::STEP);
+            alive = step(state, dir, recorder != nullptr ? &events : nullptr);
+        }
+        if (recorder != nullptr) {
+            recorder->record_move(dir);
+            if (events.apple_spawned)
+                recorder->record_apple(state.dims.cell_index(state.apple_position[0], state.apple_position[1]));
+        }
+        if (!alive)
+            break;
+        if (state.ticks - state.last_apple_tick > starvation_limit) {
+            state.death_cause = DeathCause::STARVED;
+            break;
+        }
+    }
+
+    return {snake_length(state), state.ticks, state.death_cause};
+}
+
+#define INSTANTIATE(D) \
+    template GameSummary run_headless_game(GameState<D>&, Controller<D>&, ReplayRecorder*);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,175 @@
+#include <stdexcept>
+
+#include "snakectl.h"
+
+template<typename D>
+Direction snake_decide(std::array<u16, 2> apple_position, std::array<u16, 2> current_head_position, Direction current_direction, const Bitboard<D>& board,
+                       const Reachability<D>* reachability, const BlindParams& params) {
+    // I'm calling this Blind Snake Algorithm
+    // It sees by smell...
+
+    const u8 laziness = params.laziness; // Tendency to stick to the same direction as previously when choosing between directions of equal precedence
+    const u8 max_precedence = BlindParams::MAX_PRECEDENCE;
+    const u8 neutral = params.neutral_precedence;
+    u8 dir_precedence[4] = {neutral, neutral, neutral, neutral};
+    // Indexed by Direction enum
+    // 3 is ideal
+    // 2 is neutral (by default)
+    // 1 avoid if possible (by default)
+    // 0 avoid at all costs
+
+    // ------------------------------ General Ranking -------------------------------- //
+
+    // Get ideal X direction
+
+    bool moving_incorrect_y = (current_head_position[1] < apple_position[1] && current_direction == UP) ||
+        (current_head_position[1] > apple_position[1] && current_direction == DOWN);
+    bool moving_incorrect_x = (current_head_position[0] < apple_position[0] && current_direction == LEFT) ||
+        (current_head_position[0] > apple_position[0] && current_direction == RIGHT);
+
+    if (current_head_position[0] < apple_position[0])
+        dir_precedence[RIGHT] = max_precedence;
+    else if (current_head_position[0] > apple_position[0])
+        dir_precedence[LEFT] = max_precedence;
+    else if (!moving_incorrect_y) {
+        // Aligned with apple. Moving is counter-productive
+        dir_precedence[LEFT] = params.aligned_precedence;
+        dir_precedence[RIGHT] = params.aligned_precedence;
+    }
+
+    // Get ideal Y direction
+    if (current_head_position[1] < apple_position[1])
+        dir_precedence[UP] = max_precedence;
+    else if (current_head_position[1] > apple_position[1])
+        dir_precedence[DOWN] = max_precedence;
+    else if (!moving_incorrect_x) {
+        // Aligned with apple. Moving is counter-productive
+        dir_precedence[UP] = params.aligned_precedence;
+        dir_precedence[DOWN] = params.aligned_precedence;
+    }
+
+    // ------------------------------ Invalidate any Obstructed Directions -------------------------------- //
+
+    // One bit per direction that leads onto a free tile inside the board
+    const u8 free_directions = board.free_neighbors(current_head_position[0], current_head_position[1]);
+
+    for (u8 i = 0; i < 4; i++) {
+        // Check if any direction is obstructed (This also prevents doing 180 turns)
+        if ((free_directions & (1 << i)) == 0)
+            dir_precedence[i] = 0;
+    }
+
+    // ------------------------------ Avoid Dead Ends -------------------------------- //
+
+    // Moving into a smaller region than another free direction offers is how the snake traps itself
+    if (reachability != nullptr) {
+        const u32 head_cell = board.dims.cell_index(current_head_position[0], current_head_position[1]);
+        u32 region[4];
+        u32 largest_region = 0;
+        for (u8 i = 0; i < 4; i++) {
+            region[i] = dir_precedence[i] > 0 ? reachability->reachable_after_move(head_cell, static_cast<Direction>(i)) : 0;
+            if (region[i] > largest_region)
+                largest_region = region[i];
+        }
+        for (u8 i = 0; i < 4; i++) {
+            if (dir_precedence[i] > params.pocket_precedence && region[i] < largest_region)
+                dir_precedence[i] = params.pocket_precedence;
+        }
+    }
+
+    // ------------------------------ Pick Random Best Precedence -------------------------------- //
+
+    // More likely to keep current_direction
+    // Drawn out of 256, a power of two, so the default of 128 takes exactly the draws the 1/2 coin used to
+    if (dir_precedence[current_direction] == max_precedence && random_int(0, 255) < params.keep_chance)
+        return current_direction;
+
+    auto pick_random = [&current_direction, &laziness](u8 dir_precedence[4], u8 precedence) -> std::optional<Direction> {
+        u8 choices[4];
+        u8 choices_len = 0;
+
+        for (u8 i = 0; i < 4; ++i) {
+            if (dir_precedence[i] == precedence) {
+                choices[choices_len++] = i;
+                if (static_cast<Direction>(i) == current_direction &&
+                    random_int(u8(0), laziness) > 0)
+                {
+                    return std::optional(current_direction);
+                }
+            }
+        }
+
+        if (choices_len == 0) {
+            return std::nullopt;
+        }
+
+        u8 choice_idx = random_int(u8(0), u8(choices_len - 1));
+
+        return std::optional(static_cast<Direction>(choices[choice_idx]));
+    };
+
+    Direction chosen_dir = UP; // To heaven
+
+    for (u8 p = max_precedence; p >= 0; --p) {
+        std::optional<Direction> dir = pick_random(dir_precedence, p);
+        if (dir.has_value()) {
+            chosen_dir = dir.value();
+            break;
+        }
+    }
+
+    return chosen_dir;
+}
+
+bool parse_blind_params(const std::string& text, BlindParams& params) {
+    BlindParams parsed = params;
+    usize start = 0;
+    while (start < text.size()) {
+        usize end = text.find(',', start);
+        if (end == std::string::npos)
+            end = text.size();
+        const std::string item = text.substr(start, end - start);
+        start = end + 1;
+
+        const usize equals = item.find('=');
+        if (equals == std::string::npos)
+            return false;
+        const std::string key = item.substr(0, equals);
+        u64 value;
+        try {
+            usize used;
+            value = std::stoull(item.substr(equals + 1), &used);
+            if (used != item.size() - equals - 1)
+                return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+
+        const bool level = value >= 1 && value <= BlindParams::MAX_PRECEDENCE;
+        if (key == "laziness" && value <= 255)
+            parsed.laziness = static_cast<u8>(value);
+        else if (key == "keep" && value <= 256)
+            parsed.keep_chance = static_cast<u16>(value);
+        else if (key == "neutral" && level)
+            parsed.neutral_precedence = static_cast<u8>(value);
+        else if (key == "aligned" && level)
+            parsed.aligned_precedence = static_cast<u8>(value);
+        else if (key == "pocket" && level)
+            parsed.pocket_precedence = static_cast<u8>(value);
+        else
+            return false;
+    }
+    params = parsed;
+    return true;
+}
+
+std::string format_blind_params(const BlindParams& params) {
+    return "laziness=" + std::to_string(params.laziness) + ",keep=" + std::to_string(params.keep_chance) +
+           ",neutral=" + std::to_string(params.neutral_precedence) + ",aligned=" + std::to_string(params.aligned_precedence) +
+           ",pocket=" + std::to_string(params.pocket_precedence);
+}
+
+#define INSTANTIATE(D) \
+    template Direction snake_decide(std::array<u16, 2>, std::array<u16, 2>, Direction, const Bitboard<D>&, const Reachability<D>*, \
+                                    const BlindParams&);
+SNAKE_FOR_EACH_DIMS(INSTANTIATE)
@@ -0,0 +1,106 @@
+#include "thread_pool.h"
+#include "phase_stats.h"
+
+static thread_local const ThreadPool* current_pool = nullptr;
+static thread_local int current_worker = -1;
+
+ThreadPool::ThreadPool(u32 thread_count) {
+    if (thread_count == 0)
+        thread_count = 1;
+
+    for (u32 i = 0; i < thread_count; ++i)
+        queues.push_back(std::make_unique<WorkerQueue>());
+    for (u32 i = 0; i < thread_count; ++i)
+        threads.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    u32 index = (current_pool == this) ? static_cast<u32>(current_worker)
+                                       : next_queue.fetch_add(1, std::memory_order_relaxed) % size();
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // Incremented under state_mutex so a worker can't miss the wakeup between checking and sleeping
+        std::lock_guard<std::mutex> lock(state_mutex);
+        queued.fetch_add(1);
+    }
+    work_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    all_done.wait(lock, [this] { return pending.load() == 0; });
+}
+
+int ThreadPool::worker_index() {
+    return current_worker;
+}
+
+bool ThreadPool::try_pop(u32 index, std::function<void()>& task) {
+    // Own queue first (newest task, still warm in cache)
+    {
+        WorkerQueue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    // Steal the oldest task from someone else. queues, not threads: the constructor may still be starting workers
+    const u32 count = static_cast<u32>(queues.size());
+    for (u32 i = 1; i < count; ++i) {
+        WorkerQueue& victim = *queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(u32 index) {
+    current_pool = this;
+    current_worker = static_cast<int>(index);
+    SNAKE_PHASE_STATS_THREAD_START();
+
+    std::function<void()> task;
+    while (true) {
+        if (try_pop(index, task)) {
+            queued.fetch_sub(1);
+            task();
+            task = nullptr;
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(state_mutex);
+                all_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(state_mutex);
+        work_available.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0)
+            return;
+    }
+}
+
+u32 default_thread_count() {
+    u32 count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include "tuner.h"
+#include "batch.h"
+#include "random_utils.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+// Games per task. Big enough to amortize queueing, small enough to leave something to steal
+static constexpr u32 GAMES_PER_TASK = 16;
+
+// Values the grid tries for every knob
+static const u8 GRID_LAZINESS[] = {0, 1, 2, 3, 5, 8};
+static const u16 GRID_KEEP_CHANCE[] = {0, 64, 128, 192, 256};
+static const u8 GRID_PRECEDENCE[] = {1, 2, 3};
+static const u8 GRID_START_GROW[] = {0, 1, 2, 4, 8};
+static const u16 GRID_GROW_RATE[] = {1, 2, 3, 4, 6};
+
+// Ranges evolution keeps the knobs in. grow_timer is a u8, so the growth rules stay small
+static constexpr u8 MAX_LAZINESS = 16;
+static constexpr u8 MAX_START_GROW = 16;
+static constexpr u16 MAX_GROW_RATE = 8;
+
+// ============================================================ //
+// Candidates
+
+// Packs every knob, so a candidate that comes up again is not played again
+static u64 candidate_key(const TuneCandidate& c) {
+    return u64(c.blind.laziness) | u64(c.blind.keep_chance) << 8 | u64(c.blind.neutral_precedence) << 20 |
+           u64(c.blind.aligned_precedence) << 24 | u64(c.blind.pocket_precedence) << 28 |
+           u64(c.rules.start_grow_timer) << 32 | u64(c.rules.grow_rate) << 40;
+}
+
+static std::vector<TuneCandidate> grid_candidates(const TuneOptions& options) {
+    const bool pockets = options.controller == ControllerKind::BLIND_REACHABILITY;
+    const TuneCandidate defaults;
+    std::vector<u8> pocket_levels = pockets ? std::vector<u8>(std::begin(GRID_PRECEDENCE), std::end(GRID_PRECEDENCE))
+                                            : std::vector<u8>{defaults.blind.pocket_precedence};
+    std::vector<u8> start_grows = options.rules ? std::vector<u8>(std::begin(GRID_START_GROW), std::end(GRID_START_GROW))
+                                                : std::vector<u8>{defaults.rules.start_grow_timer};
+    std::vector<u16> grow_rates = options.rules ? std::vector<u16>(std::begin(GRID_GROW_RATE), std::end(GRID_GROW_RATE))
+                                                : std::vector<u16>{defaults.rules.grow_rate};
+
+    std::vector<TuneCandidate> candidates;
+    for (u8 laziness : GRID_LAZINESS)
+        for (u16 keep_chance : GRID_KEEP_CHANCE)
+            for (u8 neutral : GRID_PRECEDENCE)
+                for (u8 aligned : GRID_PRECEDENCE)
+                    for (u8 pocket : pocket_levels)
+                        for (u8 start_grow : start_grows)
+                            for (u16 grow_rate : grow_rates) {
+                                TuneCandidate c;
+                                c.blind.laziness = laziness;
+                                c.blind.keep_chance = keep_chance;
+                                c.blind.neutral_precedence = neutral;
+                                c.blind.aligned_precedence = aligned;
+                                c.blind.pocket_precedence = pocket;
+                                c.rules.start_grow_timer = start_grow;
+                                c.rules.grow_rate = grow_rate;
+                                candidates.push_back(c);
+                            }
+    return candidates;
+}
+
+// Moves every knob with probability 1/3, and at least one of them
+static TuneCandidate mutate(TuneCandidate c, const TuneOptions& options, Xoshiro256& rng) {
+    const bool pockets = options.controller == ControllerKind::BLIND_REACHABILITY;
+    const u32 knobs = options.rules ? 7 : 5;
+    auto nudge = [&rng](i32 value, i32 step, i32 min, i32 max) {
+        const i32 delta = static_cast<i32>(random_below(rng, u32(step))) + 1;
+        return std::clamp(random_below(rng, 2u) == 0 ? value - delta : value + delta, min, max);
+    };
+
+    const u64 before = candidate_key(c);
+    while (candidate_key(c) == before) {
+        for (u32 knob = 0; knob < knobs; ++knob) {
+            if (random_below(rng, 3u) != 0)
+                continue;
+            switch (knob) {
+                case 0: c.blind.laziness = static_cast<u8>(nudge(c.blind.laziness, 2, 0, MAX_LAZINESS)); break;
+                case 1: c.blind.keep_chance = static_cast<u16>(nudge(c.blind.keep_chance, 48, 0, 256)); break;
+                case 2: c.blind.neutral_precedence = static_cast<u8>(nudge(c.blind.neutral_precedence, 1, 1, BlindParams::MAX_PRECEDENCE)); break;
+                case 3: c.blind.aligned_precedence = static_cast<u8>(nudge(c.blind.aligned_precedence, 1, 1, BlindParams::MAX_PRECEDENCE)); break;
+                case 4:
+                    if (pockets)
+                        c.blind.pocket_precedence = static_cast<u8>(nudge(c.blind.pocket_precedence, 1, 1, BlindParams::MAX_PRECEDENCE));
+                    break;
+                case 5: c.rules.start_grow_timer = static_cast<u8>(nudge(c.rules.start_grow_timer, 2, 0, MAX_START_GROW)); break;
+                case 6: c.rules.grow_rate = static_cast<u16>(nudge(c.rules.grow_rate, 1, 1, MAX_GROW_RATE)); break;
+            }
+        }
+    }
+    return c;
+}
+
+// Every knob from either parent
+static TuneCandidate crossover(const TuneCandidate& a, const TuneCandidate& b, Xoshiro256& rng) {
+    auto pick = [&rng](auto x, auto y) { return random_below(rng, 2u) == 0 ? x : y; };
+    TuneCandidate c;
+    c.blind.laziness = pick(a.blind.laziness, b.blind.laziness);
+    c.blind.keep_chance = pick(a.blind.keep_chance, b.blind.keep_chance);
+    c.blind.neutral_precedence = pick(a.blind.neutral_precedence, b.blind.neutral_precedence);
+    c.blind.aligned_precedence = pick(a.blind.aligned_precedence, b.blind.aligned_precedence);
+    c.blind.pocket_precedence = pick(a.blind.pocket_precedence, b.blind.pocket_precedence);
+    c.rules.start_grow_timer = pick(a.rules.start_grow_timer, b.rules.start_grow_timer);
+    c.rules.grow_rate = pick(a.rules.grow_rate, b.rules.grow_rate);
+    return c;
+}
+
+// ============================================================ //
+// Evaluation
+
+static TuneScore summarize(const std::vector<u32>& lengths, u32 games, u32 board_full, bool stopped_early) {
+    TuneScore score;
+    score.games = games;
+    score.board_full = board_full;
+    score.stopped_early = stopped_early;
+    if (games == 0)
+        return score;
+
+    std::vector<u32> sorted(lengths.begin(), lengths.begin() + games);
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0, square_sum = 0;
+    for (u32 length : sorted) {
+        sum += length;
+        square_sum += double(length) * length;
+    }
+    score.mean = sum / games;
+    score.stddev = games > 1 ? std::sqrt(std::max(0.0, (square_sum - sum * score.mean) / (games - 1))) : 0;
+    score.min = sorted.front();
+    score.p10 = sorted_percentile(sorted, 0.1);
+    score.median = sorted_percentile(sorted, 0.5);
+    score.p90 = sorted_percentile(sorted, 0.9);
+    score.max = sorted.back();
+    return score;
+}
+
+// True when the games played so far show the candidate is clearly worse than the best: the mean of the per-game
+// differences is more than sigmas standard errors below zero
+static bool clearly_worse(const std::vector<u32>& lengths, const std::vector<u32>& best_lengths, u32 games, double sigmas) {
+    double sum = 0, square_sum = 0;
+    for (u32 i = 0; i < games; ++i) {
+        const double difference = double(lengths[i]) - double(best_lengths[i]);
+        sum += difference;
+        square_sum += difference * difference;
+    }
+    const double mean = sum / games;
+    const double variance = std::max(0.0, (square_sum - sum * mean) / (games - 1));
+    return mean + sigmas * std::sqrt(variance / games) < 0;
+}
+
+template<typename D>
+class TuneEvaluator {
+public:
+    TuneEvaluator(const D& dims, const TuneOptions& options)
+        : dims(dims), options(options), pool(std::max(1u, options.threads)), states(pool.size()),
+          lengths(options.games), outcomes(options.games) {}
+
+    // Plays the candidate's games stage by stage. Without best_lengths (the first candidate), plays them all
+    TuneScore evaluate(const TuneCandidate& candidate, const std::vector<u32>* best_lengths) {
+        const u32 stages = std::clamp(options.stages, 1u, options.games);
+        u32 played = 0;
+        bool stopped_early = false;
+        for (u32 stage = 1; stage <= stages; ++stage) {
+            const u32 last = u32(u64(options.games) * stage / stages);
+            play(candidate, played, last);
+            played = last;
+            if (best_lengths != nullptr && played < options.games && played > 1 && options.stop_sigmas > 0 &&
+                clearly_worse(lengths, *best_lengths, played, options.stop_sigmas)) {
+                stopped_early = true;
+                break;
+            }
+        }
+        games += played;
+        const u32 board_full = static_cast<u32>(std::count(outcomes.begin(), outcomes.begin() + played, DeathCause::BOARD_FULL));
+        return summarize(lengths, played, board_full, stopped_early);
+    }
+
+    // Final lengths of the last evaluated candidate
+    const std::vector<u32>& last_lengths() const { return lengths; }
+
+    u64 games = 0; // Played so far, over every candidate
+
+private:
+    // Games [first, last) over the pool. Game i is seeded the same for every candidate
+    void play(const TuneCandidate& candidate, u32 first, u32 last) {
+        for (u32 task_first = first; task_first < last; task_first += GAMES_PER_TASK) {
+            const u32 task_last = std::min(last, task_first + GAMES_PER_TASK);
+            pool.submit([this, &candidate, task_first, task_last] {
+                // One state per worker, on the heap: a GameState for a large fixed board is too big for a stack
+                std::unique_ptr<GameState<D>>& state = states[ThreadPool::worker_index()];
+                if (state == nullptr)
+                    state = std::make_unique<GameState<D>>(dims);
+                state->rules = candidate.rules;
+                Controller<D> controller(options.controller, dims, RolloutOptions(), candidate.blind);
+                for (u32 i = task_first; i < task_last; ++i) {
+                    seed_rng(derive_seed(options.seed, i));
+                    const GameSummary summary = run_headless_game(*state, controller);
+                    lengths[i] = summary.length;
+                    outcomes[i] = summary.death_cause;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    D dims;
+    TuneOptions options;
+    ThreadPool pool;
+    std::vector<std::unique_ptr<GameState<D>>> states; // One per worker
+    std::vector<u32> lengths;
+    std::vector<DeathCause> outcomes;
+};
+
+// ============================================================ //
+// Search
+
+template<typename D>
+static TuneResult tune(const D& dims, const TuneOptions& options, const TuneProgress& progress) {
+    const auto start = std::chrono::steady_clock::now();
+    TuneEvaluator<D> evaluator(dims, options);
+    TuneResult result;
+    std::vector<u32> best_lengths;
+    std::map<u64, TuneScore> scores;
+
+    // Plays a candidate unless it was played before. The defaults go first and set the bar
+    auto evaluate = [&](const TuneCandidate& candidate) {
+        const u64 key = candidate_key(candidate);
+        const auto found = scores.find(key);
+        if (found != scores.end())
+            return found->second;
+
+        const TuneScore score = evaluator.evaluate(candidate, result.candidates == 0 ? nullptr : &best_lengths);
+        scores[key] = score;
+        result.candidates++;
+        result.stopped_early += score.stopped_early;
+        const bool new_best = result.candidates == 1 || (!score.stopped_early && score.mean > result.best_score.mean);
+        if (new_best) {
+            result.best = candidate;
+            result.best_score = score;
+            best_lengths = evaluator.last_lengths();
+        }
+        if (result.candidates == 1)
+            result.default_score = score;
+        if (progress)
+            progress(result.candidates, candidate, score, new_best);
+        return score;
+    };
+
+    evaluate(TuneCandidate());
+    if (options.search == TuneSearch::GRID) {
+        for (const TuneCandidate& candidate : grid_candidates(options)) {
+            evaluate(candidate);
+        }
+    }
+    else {
+        // Drawn from its own stream, so the search does not depend on the games
+        Xoshiro256 rng(derive_seed(options.seed, ~u64(0)));
+        const u32 population = std::max(4u, options.population);
+        const u32 survivors = std::max(2u, population / 4);
+
+        std::vector<TuneCandidate> generation = {TuneCandidate()};
+        while (generation.size() < population) {
+            generation.push_back(mutate(mutate(TuneCandidate(), options, rng), options, rng));
+        }
+        for (u32 round = 0; round < options.generations; ++round) {
+            std::vector<std::pair<TuneScore, TuneCandidate>> ranked;
+            std::vector<u64> keys;
+            for (const TuneCandidate& candidate : generation) {
+                const u64 key = candidate_key(candidate);
+                if (std::find(keys.begin(), keys.end(), key) != keys.end())
+                    continue;
+                keys.push_back(key);
+                ranked.emplace_back(evaluate(candidate), candidate);
+            }
+            // Candidates that played every game first, then those stopped early, each by mean length
+            std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+                if (a.first.stopped_early != b.first.stopped_early)
+                    return !a.first.stopped_early;
+                return a.first.mean > b.first.mean;
+            });
+
+            generation.clear();
+            for (u32 i = 0; i < survivors && i < ranked.size(); ++i) {
+                generation.push_back(ranked[i].second);
+            }
+            const u32 parents = static_cast<u32>(generation.size());
+            while (generation.size() < population) {
+                const TuneCandidate a = generation[random_below(rng, parents)];
+                const TuneCandidate b = generation[random_below(rng, parents)];
+                generation.push_back(mutate(crossover(a, b, rng), options, rng));
+            }
+        }
+    }
+
+    result.games = evaluator.games;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+TuneResult run_tuner(u16 width, u16 height, const TuneOptions& options, const TuneProgress& progress) {
+    if (options.controller != ControllerKind::BLIND && options.controller != ControllerKind::BLIND_REACHABILITY)
+        throw(std::runtime_error("The tuner only tunes the blind and blind-reach controllers"));
+    if (options.games == 0)
+        throw(std::runtime_error("The tuner needs at least one game per candidate"));
+    return with_board_dims(width, height, [&](auto dims) { return tune(dims, options, progress); });
+}
+
+std::string format_game_rules(const GameRules& rules) {
+    return "start_grow=" + std::to_string(rules.start_grow_timer) + ",grow_rate=" + std::to_string(rules.grow_rate);
+}
+
+bool parse_tune_search(const std::string& name, TuneSearch& search) {
+    if (name == "grid")
+        search = TuneSearch::GRID;
+    else if (name == "evolve")
+        search = TuneSearch::EVOLVE;
+    else
+        return false;
+    return true;
+}
+
+const char* tune_search_name(TuneSearch search) {
+    switch (search) {
+        case TuneSearch::GRID:   return "grid";
+        case TuneSearch::EVOLVE: return "evolve";
+    }
+    return "unknown";
+}
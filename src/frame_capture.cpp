@@ -0,0 +1,241 @@
+#include <SFML/OpenGL.hpp>
+#include <GL/glext.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "frame_capture.h"
+
+// Buffer object entry points are not part of GL 1.1, so they are looked up at run time
+struct PboFunctions {
+    PFNGLGENBUFFERSPROC gen_buffers = nullptr;
+    PFNGLDELETEBUFFERSPROC delete_buffers = nullptr;
+    PFNGLBINDBUFFERPROC bind_buffer = nullptr;
+    PFNGLBUFFERDATAPROC buffer_data = nullptr;
+    PFNGLMAPBUFFERPROC map_buffer = nullptr;
+    PFNGLUNMAPBUFFERPROC unmap_buffer = nullptr;
+};
+
+static PboFunctions gl;
+
+// Needs an active context. False if the driver lacks any of them
+static bool load_pbo_functions() {
+    gl.gen_buffers = reinterpret_cast<PFNGLGENBUFFERSPROC>(sf::Context::getFunction("glGenBuffers"));
+    gl.delete_buffers = reinterpret_cast<PFNGLDELETEBUFFERSPROC>(sf::Context::getFunction("glDeleteBuffers"));
+    gl.bind_buffer = reinterpret_cast<PFNGLBINDBUFFERPROC>(sf::Context::getFunction("glBindBuffer"));
+    gl.buffer_data = reinterpret_cast<PFNGLBUFFERDATAPROC>(sf::Context::getFunction("glBufferData"));
+    gl.map_buffer = reinterpret_cast<PFNGLMAPBUFFERPROC>(sf::Context::getFunction("glMapBuffer"));
+    gl.unmap_buffer = reinterpret_cast<PFNGLUNMAPBUFFERPROC>(sf::Context::getFunction("glUnmapBuffer"));
+    return gl.gen_buffers && gl.delete_buffers && gl.bind_buffer && gl.buffer_data && gl.map_buffer && gl.unmap_buffer;
+}
+
+FrameCapture::FrameCapture(const std::string& path, CaptureFormat format, sf::Vector2u size, u32 queue_frames)
+    : path(path), format(format), size(size), frame_bytes(usize(size.x) * size.y * 4), texture(size), stream(nullptr),
+      next_pbo(0), closing(false) {
+    if (format == CaptureFormat::RAW) {
+        stream = std::fopen(path.c_str(), "wb");
+        if (stream == nullptr)
+            throw(std::runtime_error("Could not open " + path + " for the frame capture"));
+    }
+    else {
+        std::error_code error;
+        std::filesystem::create_directories(path, error);
+        if (error)
+            throw(std::runtime_error("Could not create the frame capture directory " + path));
+    }
+
+    queue_frames = std::max(1u, queue_frames);
+    counters.queue_capacity = queue_frames;
+    // One more buffer than the queue holds: the one the worker is writing
+    free_buffers.assign(queue_frames + 1, std::vector<u8>(frame_bytes));
+
+    if (texture.setActive(true) && load_pbo_functions()) {
+        pbos.resize(PBO_COUNT);
+        gl.gen_buffers(PBO_COUNT, pbos.data());
+        for (u32 pbo : pbos) {
+            gl.bind_buffer(GL_PIXEL_PACK_BUFFER, pbo);
+            gl.buffer_data(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(frame_bytes), nullptr, GL_STREAM_READ);
+        }
+        gl.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+        pbo_frame.assign(PBO_COUNT, NO_FRAME);
+        counters.async_readback = true;
+    }
+
+    worker = std::thread(&FrameCapture::run, this);
+}
+
+FrameCapture::~FrameCapture() {
+    finish();
+}
+
+CaptureStats FrameCapture::finish() {
+    if (closing)
+        return counters;
+    if (!pbos.empty() && texture.setActive(true)) {
+        // Oldest first, so frames stay in order
+        for (u32 i = 0; i < PBO_COUNT; ++i) {
+            const u32 pbo = (next_pbo + i) % PBO_COUNT;
+            if (pbo_frame[pbo] != NO_FRAME)
+                finish_readback(pbo);
+        }
+        gl.delete_buffers(PBO_COUNT, pbos.data());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    work_available.notify_one();
+    worker.join();
+    if (stream != nullptr && std::fclose(stream) != 0)
+        counters.failed++;
+    stream = nullptr;
+    return counters;
+}
+
+void FrameCapture::capture() {
+    texture.display();
+    const u64 index = counters.frames++;
+
+    if (pbos.empty()) {
+        const sf::Image image = texture.getTexture().copyToImage();
+        hand_off(index, false, image.getPixelsPtr());
+        return;
+    }
+
+    if (!texture.setActive(true))
+        return;
+    // The PBO about to be reused holds the readback started PBO_COUNT frames ago, which is done by now
+    const u32 pbo = next_pbo;
+    if (pbo_frame[pbo] != NO_FRAME)
+        finish_readback(pbo);
+    gl.bind_buffer(GL_PIXEL_PACK_BUFFER, pbos[pbo]);
+    // With a pack buffer bound, glReadPixels only queues the copy. Its pointer argument is an offset into the buffer
+    glReadPixels(0, 0, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gl.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    pbo_frame[pbo] = index;
+    next_pbo = (pbo + 1) % PBO_COUNT;
+}
+
+void FrameCapture::finish_readback(u32 pbo) {
+    gl.bind_buffer(GL_PIXEL_PACK_BUFFER, pbos[pbo]);
+    if (const void* pixels = gl.map_buffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY)) {
+        hand_off(pbo_frame[pbo], true, static_cast<const u8*>(pixels));
+        gl.unmap_buffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.failed++;
+    }
+    gl.bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+    pbo_frame[pbo] = NO_FRAME;
+}
+
+void FrameCapture::hand_off(u64 index, bool bottom_up, const u8* pixels) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (free_buffers.empty() || queue.size() >= counters.queue_capacity) {
+        counters.dropped++;
+        return;
+    }
+    std::vector<u8> buffer = std::move(free_buffers.back());
+    free_buffers.pop_back();
+    lock.unlock();
+
+    std::memcpy(buffer.data(), pixels, frame_bytes);
+
+    lock.lock();
+    queue.push_back(Frame{index, bottom_up, std::move(buffer)});
+    counters.peak_queued = std::max(counters.peak_queued, static_cast<u32>(queue.size()));
+    lock.unlock();
+    work_available.notify_one();
+}
+
+void FrameCapture::write_frame(Frame& frame) {
+    const usize row_bytes = usize(size.x) * 4;
+    auto row = [&](u32 y) {
+        return frame.pixels.data() + (frame.bottom_up ? size.y - 1 - y : y) * row_bytes;
+    };
+    auto file_path = [&] {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06llu.%s", static_cast<unsigned long long>(frame.index), capture_format_name(format));
+        return (std::filesystem::path(path) / name).string();
+    };
+
+    bool written = true;
+    switch (format) {
+        case CaptureFormat::RAW:
+            for (u32 y = 0; y < size.y && written; ++y) {
+                written = std::fwrite(row(y), 1, row_bytes, stream) == row_bytes;
+            }
+            break;
+        case CaptureFormat::PPM: {
+            scratch.resize(usize(size.x) * size.y * 3);
+            u8* out = scratch.data();
+            for (u32 y = 0; y < size.y; ++y) {
+                const u8* in = row(y);
+                for (u32 x = 0; x < size.x; ++x, in += 4, out += 3) {
+                    out[0] = in[0];
+                    out[1] = in[1];
+                    out[2] = in[2];
+                }
+            }
+            std::FILE* file = std::fopen(file_path().c_str(), "wb");
+            written = file != nullptr && std::fprintf(file, "P6\n%u %u\n255\n", size.x, size.y) > 0 &&
+                      std::fwrite(scratch.data(), 1, scratch.size(), file) == scratch.size();
+            if (file != nullptr)
+                written = std::fclose(file) == 0 && written;
+            break;
+        }
+        case CaptureFormat::PNG: {
+            scratch.resize(frame_bytes);
+            for (u32 y = 0; y < size.y; ++y) {
+                std::memcpy(scratch.data() + y * row_bytes, row(y), row_bytes);
+            }
+            // Image and its PNG encoder are CPU only, so this is safe away from the GL thread
+            written = sf::Image(size, scratch.data()).saveToFile(file_path());
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    (written ? counters.written : counters.failed)++;
+}
+
+void FrameCapture::run() {
+    for (;;) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [this] { return closing || !queue.empty(); });
+            if (queue.empty())
+                return;
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        write_frame(frame);
+        std::lock_guard<std::mutex> lock(mutex);
+        free_buffers.push_back(std::move(frame.pixels));
+    }
+}
+
+bool parse_capture_format(const std::string& name, CaptureFormat& format) {
+    if (name == "ppm")
+        format = CaptureFormat::PPM;
+    else if (name == "png")
+        format = CaptureFormat::PNG;
+    else if (name == "raw")
+        format = CaptureFormat::RAW;
+    else
+        return false;
+    return true;
+}
+
+const char* capture_format_name(CaptureFormat format) {
+    switch (format) {
+        case CaptureFormat::PPM: return "ppm";
+        case CaptureFormat::PNG: return "png";
+        case CaptureFormat::RAW: return "raw";
+    }
+    return "unknown";
+}
@@ -1,6 +1,16 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "highscore.h"
 
 namespace fs = std::filesystem;
+using highscore_clock = std::chrono::steady_clock;
+
+// Improvements within this long of the last write are held back and written together
+static constexpr std::chrono::seconds HIGHSCORE_WRITE_INTERVAL(1);
 
 static fs::path get_user_home_dir() {
     // 1. Linux/macOS (Preferred: HOME)
@@ -29,48 +39,22 @@ static fs::path get_snake_highscore_path() {
     return highscore_path;
 }
 
-// Encrypt plaintext with AES-256-CBC
-static std::vector<unsigned char> aes_encrypt(const std::vector<unsigned char>& plaintext,
-                                              const std::array<unsigned char, 32>& key,
-                                              std::array<unsigned char, 16>& iv_out)
-{
-    if(!RAND_bytes(iv_out.data(), iv_out.size()))
-        throw std::runtime_error("Failed to generate IV");
-
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key.data(), iv_out.data());
-
-    std::vector<unsigned char> ciphertext(plaintext.size() + 16); // extra for padding
-    int outlen = 0, tmplen = 0;
-
-    EVP_EncryptUpdate(ctx, ciphertext.data(), &outlen, plaintext.data(), plaintext.size());
-    EVP_EncryptFinal_ex(ctx, ciphertext.data() + outlen, &tmplen);
-    outlen += tmplen;
-    ciphertext.resize(outlen);
-
-    EVP_CIPHER_CTX_free(ctx);
-    return ciphertext;
-}
-
-// Decrypt AES-256-CBC ciphertext
-static std::vector<unsigned char> aes_decrypt(const std::vector<unsigned char>& ciphertext,
-                                              const std::array<unsigned char, 32>& key,
-                                              const std::array<unsigned char, 16>& iv)
-{
-    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
-    EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key.data(), iv.data());
-
-    std::vector<unsigned char> plaintext(ciphertext.size());
-    int outlen = 0, tmplen = 0;
-
-    EVP_DecryptUpdate(ctx, plaintext.data(), &outlen, ciphertext.data(), ciphertext.size());
-    EVP_DecryptFinal_ex(ctx, plaintext.data() + outlen, &tmplen);
-    outlen += tmplen;
-    plaintext.resize(outlen);
+// Reused cipher contexts. The key never changes, so it is set once and every call only sets the IV
+struct CipherContexts {
+    EVP_CIPHER_CTX* encrypt;
+    EVP_CIPHER_CTX* decrypt;
 
-    EVP_CIPHER_CTX_free(ctx);
-    return plaintext;
-}
+    CipherContexts(const std::array<unsigned char, 32>& key) : encrypt(EVP_CIPHER_CTX_new()), decrypt(EVP_CIPHER_CTX_new()) {
+        if (encrypt == nullptr || decrypt == nullptr ||
+            !EVP_EncryptInit_ex(encrypt, EVP_aes_256_cbc(), NULL, key.data(), NULL) ||
+            !EVP_DecryptInit_ex(decrypt, EVP_aes_256_cbc(), NULL, key.data(), NULL))
+            throw std::runtime_error("Failed to set up the highscore cipher");
+    }
+    ~CipherContexts() {
+        EVP_CIPHER_CTX_free(encrypt);
+        EVP_CIPHER_CTX_free(decrypt);
+    }
+};
 
 static std::array<unsigned char, 32>& get_key() {
     static std::array<unsigned char, 32> arr;
@@ -86,44 +70,79 @@ static std::array<unsigned char, 32>& get_key() {
 
 static constexpr std::array<unsigned char, 32> tamper_signature = {238, 6, 209, 233, 120, 88, 33, 91, 96, 64, 93, 58, 209, 114, 161, 242, 120, 156, 47, 203, 114, 55, 238, 64, 242, 83, 213, 197, 161, 51, 100, 193 };
 
-// TODO: Make this not throw. It should just output to cerr.
-void save_highscore(u32 highscore) {
-
-    fs::path highscore_path = get_snake_highscore_path();
-
-    std::vector<unsigned char> plainbytes;
-    plainbytes.push_back((highscore >> 24) & 0xFF);
-    plainbytes.push_back((highscore >> 16) & 0xFF);
-    plainbytes.push_back((highscore >> 8) & 0xFF);
-    plainbytes.push_back(highscore & 0xFF);
-
-    plainbytes.insert(plainbytes.end(), tamper_signature.begin(), tamper_signature.end());
-
-    std::array<unsigned char, 16> iv;
-    std::vector<unsigned char> encrypted_bytes = aes_encrypt(plainbytes, get_key(), iv);
+static CipherContexts& get_cipher() {
+    static CipherContexts contexts(get_key());
+    return contexts;
+}
 
-    std::ofstream out(highscore_path, std::ios::binary);
-    if (!out) throw std::runtime_error("Failed to open highscore file");
+// Record plus tamper signature, padded to 3 AES blocks
+static constexpr usize PLAIN_BYTES = 4 + 32;
+static constexpr usize CIPHER_BYTES = 48;
+static constexpr usize FILE_BYTES = 16 + CIPHER_BYTES;
+
+// Encrypt plaintext with AES-256-CBC under a fresh IV. Returns the IV followed by the ciphertext
+static bool aes_encrypt(const std::array<unsigned char, PLAIN_BYTES>& plaintext, std::array<unsigned char, FILE_BYTES>& out) {
+    EVP_CIPHER_CTX* ctx = get_cipher().encrypt;
+    unsigned char* iv = out.data();
+    unsigned char* ciphertext = out.data() + 16;
+    if (!RAND_bytes(iv, 16) || !EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv))
+        return false;
+    int outlen = 0, tmplen = 0;
+    if (!EVP_EncryptUpdate(ctx, ciphertext, &outlen, plaintext.data(), static_cast<int>(plaintext.size())) ||
+        !EVP_EncryptFinal_ex(ctx, ciphertext + outlen, &tmplen))
+        return false;
+    return usize(outlen + tmplen) == CIPHER_BYTES;
+}
 
-    out.write(reinterpret_cast<const char*>(iv.data()), iv.size());
-    out.write(reinterpret_cast<const char*>(encrypted_bytes.data()), encrypted_bytes.size());
+// Decrypt an IV followed by AES-256-CBC ciphertext. Empty on a bad key, bad padding or a short file
+static std::vector<unsigned char> aes_decrypt(const std::vector<unsigned char>& file) {
+    if (file.size() <= 16)
+        return {};
+    EVP_CIPHER_CTX* ctx = get_cipher().decrypt;
+    if (!EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, file.data()))
+        return {};
 
-    out.close();
+    std::vector<unsigned char> plaintext(file.size());
+    int outlen = 0, tmplen = 0;
+    if (!EVP_DecryptUpdate(ctx, plaintext.data(), &outlen, file.data() + 16, static_cast<int>(file.size() - 16)) ||
+        !EVP_DecryptFinal_ex(ctx, plaintext.data() + outlen, &tmplen))
+        return {};
+    plaintext.resize(outlen + tmplen);
+    return plaintext;
 }
 
-u32 get_highscore() {
+// The record as last read or written, and the best length reported since. The file is read once, and
+// improvements are written at most once per HIGHSCORE_WRITE_INTERVAL (and at exit), so a burst of fast games
+// costs one write
+struct HighscoreCache {
+    bool loaded = false;
+    u32 stored = 0;
+    u32 best = 0;
+    highscore_clock::time_point last_write;
+
+    ~HighscoreCache() {
+        // Static destruction at exit. Nothing here may throw
+        try {
+            flush_highscore();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+};
 
-    fs::path highscore_path = get_snake_highscore_path();
+static HighscoreCache& get_cache() {
+    // Statics are destroyed in reverse order of construction, so the cipher outlives the cache's final flush
+    get_cipher();
+    static HighscoreCache cache;
+    return cache;
+}
 
-    std::ifstream in(highscore_path, std::ios::binary);
+static u32 read_highscore_file() {
+    std::ifstream in(get_snake_highscore_path(), std::ios::binary);
     if (!in)
         return 0;
-    std::array<unsigned char, 16> iv;
-    in.read(reinterpret_cast<char*>(iv.data()), iv.size());
-
-    std::vector<unsigned char> encrypted_bytes((std::istreambuf_iterator<char>(in)), {});
-
-    std::vector<unsigned char> plainbytes = aes_decrypt(encrypted_bytes, get_key(), iv);
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), {});
+    std::vector<unsigned char> plainbytes = aes_decrypt(file);
 
     if (plainbytes.size() < tamper_signature.size() + 4) return 0;
     for (int i = 0; i < 32; ++i) {
@@ -140,3 +159,64 @@ u32 get_highscore() {
     return highscore;
 }
 
+// Writes a temporary file next to the record and renames it over the record, so a crash leaves either the
+// old record or the new one, never a torn file
+static void write_highscore_file(u32 highscore) {
+    std::array<unsigned char, PLAIN_BYTES> plainbytes;
+    plainbytes[0] = (highscore >> 24) & 0xFF;
+    plainbytes[1] = (highscore >> 16) & 0xFF;
+    plainbytes[2] = (highscore >> 8) & 0xFF;
+    plainbytes[3] = highscore & 0xFF;
+    std::copy(tamper_signature.begin(), tamper_signature.end(), plainbytes.begin() + 4);
+
+    std::array<unsigned char, FILE_BYTES> file;
+    if (!aes_encrypt(plainbytes, file))
+        throw std::runtime_error("Failed to encrypt highscore");
+
+    const fs::path highscore_path = get_snake_highscore_path();
+    fs::path temp_path = highscore_path;
+    temp_path += ".tmp";
+
+    const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open highscore file");
+    const bool written = ::write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size()) && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!written) {
+        ::unlink(temp_path.c_str());
+        throw std::runtime_error("Failed to write highscore file");
+    }
+    if (::rename(temp_path.c_str(), highscore_path.c_str()) != 0) {
+        ::unlink(temp_path.c_str());
+        throw std::runtime_error("Failed to replace highscore file");
+    }
+}
+
+u32 get_highscore() {
+    HighscoreCache& cache = get_cache();
+    if (!cache.loaded) {
+        cache.stored = read_highscore_file();
+        cache.best = std::max(cache.best, cache.stored);
+        cache.loaded = true;
+    }
+    return cache.best;
+}
+
+// TODO: Make this not throw. It should just output to cerr.
+void save_highscore(u32 highscore) {
+    HighscoreCache& cache = get_cache();
+    if (highscore <= get_highscore())
+        return;
+    cache.best = highscore;
+    if (highscore_clock::now() - cache.last_write >= HIGHSCORE_WRITE_INTERVAL)
+        flush_highscore();
+}
+
+void flush_highscore() {
+    HighscoreCache& cache = get_cache();
+    if (!cache.loaded || cache.best == cache.stored)
+        return;
+    write_highscore_file(cache.best);
+    cache.stored = cache.best;
+    cache.last_write = highscore_clock::now();
+}
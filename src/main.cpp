@@ -1,33 +1,108 @@
 #include <SFML/Graphics.hpp>
-#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <vector>
 
 #include "globals.h"
+#include "board_dims.h"
+#include "board_renderer.h"
+#include "frame_capture.h"
 #include "random_utils.h"
 #include "snakectl.h"
+#include "controller.h"
 #include "highscore.h"
+#include "phase_stats.h"
+#include "playerctl.h"
+#include "game.h"
+#include "simulation.h"
+#include "replay.h"
+#include "batch.h"
+#include "arena.h"
+#include "lockstep.h"
+#include "thread_pool.h"
+#include "tuner.h"
+
+// Settings for the windowed game
+struct WindowOptions {
+    u32 tick_rate;  // Game ticks per second
+    u32 frame_rate; // Frames per second (rendering and input). 0 for no limit
+    bool interpolate;
+    bool highscore_viable;
+    ControllerKind controller_kind;
+    RolloutOptions rollout;
+    BlindParams blind_params;
+    RendererKind renderer_kind;
+    bool render_stats; // Print upload counts, frame times and input latency on exit
+    std::optional<u64> seed;                 // Game i is seeded from seed and i
+    ReplayRecorder* recorder;                // Records every game when set
+    const std::vector<ReplayGame>* playback; // Plays these games back instead of running the controller when set
+    std::optional<CaptureOptions> capture;   // Captures every frame offscreen when set
+};
+
+// Samples (microseconds) for --render-stats
+struct FrameTimings {
+    std::vector<double> render_us; // Flush, draw and display
+    std::vector<double> frame_us;  // Whole loop iteration
+    std::vector<double> input_us;  // Key press to the action it causes (upper bound, see run_window)
+};
+
+// Plays games in a window until it is closed
+template<typename D>
+void run_window(const D& dims, const WindowOptions& options);
+
+// Prints the uploads per frame, frame time and input latency distributions, for --render-stats
+void print_render_stats(const BoardRenderer& renderer, FrameTimings& timings);
 
-struct Snake {
-    Direction direction;
-    u8 grow_timer;
-    std::deque<std::array<u16, 2>> deque; // Keeps track of head and tail with O(1) insertion + deletion on front and back
+// Prints what became of every direction key press and the press to move latency, for --render-stats with the player
+void print_player_stats(PlayerInputStats stats);
+
+// Prints how many frames --capture wrote and dropped
+void print_capture_stats(const CaptureStats& stats);
+
+// Writes the phase histograms of every thread for --stats: CSV if path ends in .csv, JSON otherwise
+void write_phase_stats(const std::string& path);
+
+// Writes the --stats file (if one was asked for) on the way out, so every mode writes it whichever way it returns
+struct PhaseStatsOnExit {
+    std::string path;
+
+    ~PhaseStatsOnExit() {
+        if (!path.empty())
+            write_phase_stats(path);
+    }
 };
 
-// Set a square (6 vertices) to a color
-void set_square_vertices_color(sf::Vertex* vertices, sf::Color color);
+// Runs a single game without a window at full CPU speed and prints how it went
+template<typename D>
+int run_headless(const D& dims, std::optional<u64> seed, ControllerKind controller_kind, const RolloutOptions& rollout,
+                 const BlindParams& blind_params, ReplayRecorder* recorder);
 
-// Set the positions of each vertex (2 triangles, 6 vertices) to make a square
-void set_square_vertices_positions(sf::Vertex* vertices, u16 x, u16 y);
+// Plays back every game in a replay file without a window at full CPU speed
+int run_playback_headless(const std::vector<ReplayGame>& games);
 
-// Initialize all triangle positions and colors (colored according to tiles array values)
-void generate_vertex_buffer(sf::VertexBuffer& vertex_buffer, u8 tiles[HEIGHT][WIDTH]);
+// Re-simulates every game in a replay file and checks it against the recording
+int run_verify(const std::vector<ReplayGame>& games);
 
-// Overwrites a single square in the vertex_buffer to change it's color
-void update_vertex_buffer_square_color(sf::VertexBuffer& vertex_buffer, u16 x, u16 y, sf::Color color);
+// Runs an arena of many snakes without a window for `ticks` ticks and prints how it went
+template<typename D>
+int run_arena_mode(const D& dims, const ArenaOptions& options, u32 ticks);
 
-// Sets new apple position and draws it to vertex_buffer
-// Does not remove previous apple vertices. This should not be necessary because snake head should overwrite it
-void update_apple(std::array<u16, 2>& apple_position, sf::VertexBuffer& vertex_buffer, u8 tiles[HEIGHT][WIDTH]);
+// Runs many headless games in parallel and prints aggregated statistics
+// With lockstep_lanes > 0, every thread steps that many Blind Snake games together on a LockstepBatch
+int run_batch_mode(u32 games, u32 threads, u64 master_seed, ControllerKind controller_kind, const RolloutOptions& rollout,
+                   const BlindParams& blind_params, u32 lockstep_lanes, u16 width, u16 height);
+
+// Searches the Blind Snake's parameters on a width x height board and prints the best configuration
+int run_tune_mode(u16 width, u16 height, const TuneOptions& options);
+
+// Seed for a game that was not given one, so it can still be recorded
+static u64 random_seed() {
+    return (u64(std::random_device{}()) << 32) | std::random_device{}();
+}
 
 void game_over(bool highscore_viable, u32 snake_length, bool* died_bool = nullptr) {
     if (died_bool != nullptr)
@@ -45,11 +120,35 @@ void end_program(sf::RenderWindow& window, bool display_results, bool highscore_
 
 int main(int argc, char* argv[])
 {
-    sf::RenderWindow window(sf::VideoMode({WINDOW_WIDTH, WINDOW_HEIGHT}), "Snake", sf::State::Windowed);
-    // Default. Will be overwritten if -f argument given
-    window.setFramerateLimit(UPDATES_PER_SECOND);
-    window.setVerticalSyncEnabled(false);
+    // Default. Will be overwritten if -f / --tick-rate argument given
+    u32 tick_rate = UPDATES_PER_SECOND;
+    bool tick_rate_given = false;
+    u32 frame_rate = FRAMES_PER_SECOND;
+    bool interpolate = false;
     bool highscore_viable = true;
+    bool headless = false;
+    bool render_stats = false;
+    RendererKind renderer_kind = RendererKind::VERTEX;
+    u32 batch_games = 0;
+    u32 lockstep_lanes = 0;
+    u32 arena_snakes = 0;
+    u32 arena_ticks = 1000;
+    u16 width = WIDTH;
+    u16 height = HEIGHT;
+    u32 threads = default_thread_count();
+    std::optional<u64> seed;
+    std::string stats_path;
+    std::string record_path;
+    std::string replay_path;
+    std::string verify_path;
+    std::optional<CaptureOptions> capture;
+    ControllerKind controller_kind = ControllerKind::BLIND;
+    RolloutOptions rollout;
+    rollout.threads = default_thread_count();
+    BlindParams blind_params;
+    bool blind_params_given = false;
+    bool tune = false;
+    TuneOptions tune_options;
 
     // Argument handling
     for (int i = 1; i < argc; ++i) {
@@ -58,186 +157,720 @@ int main(int argc, char* argv[])
             std::cout << "The current record length is " << get_highscore() << std::endl;
             return 0;
         }
-        else if (arg == "-f") {
+        else if (arg == "-f" || arg == "--tick-rate") {
             i++;
             try {
-                u32 framerate_arg = std::stoi(argv[i]);
-                window.setFramerateLimit(framerate_arg);
-                if (framerate_arg > 20) {
+                u32 value = std::stoi(argv[i]);
+                if (value == 0)
+                    throw std::out_of_range(arg);
+                tick_rate = value;
+                tick_rate_given = true;
+                if (tick_rate > 20) {
                     highscore_viable = false;
-                    std::cout << "Framerate is greater than 20. Highscore will not be updated." << std::endl;
+                    std::cout << "Tick rate is greater than 20. Highscore will not be updated." << std::endl;
                 }
             } catch (const std::exception& e) {
-                std::cerr << "Error: Invalid framerate value provided for -f." << std::endl;
+                std::cerr << "Error: Invalid tick rate value provided for " << arg << "." << std::endl;
+            }
+        }
+        else if (arg == "--frame-rate") {
+            i++;
+            try {
+                frame_rate = std::stoi(argv[i]);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Invalid frame rate value provided for --frame-rate." << std::endl;
+            }
+        }
+        else if (arg == "--interpolate") {
+            interpolate = true;
+        }
+        else if (arg == "--stats") {
+            i++;
+            if (i >= argc) {
+                std::cerr << "Error: --stats needs an output file (.json or .csv)." << std::endl;
+                return 1;
+            }
+#ifdef SNAKE_PHASE_STATS
+            stats_path = argv[i];
+#else
+            std::cerr << "Error: --stats needs a build with phase timers (cmake -DSNAKE_PHASE_STATS=ON)." << std::endl;
+            return 1;
+#endif
+        }
+        else if (arg == "--record" || arg == "--replay" || arg == "--verify") {
+            i++;
+            if (i >= argc) {
+                std::cerr << "Error: " << arg << " needs a replay file." << std::endl;
+                return 1;
+            }
+            (arg == "--record" ? record_path : arg == "--replay" ? replay_path : verify_path) = argv[i];
+        }
+        else if (arg == "--capture" || arg == "--capture-format" || arg == "--capture-queue") {
+            i++;
+            if (i >= argc) {
+                std::cerr << "Error: " << arg << " needs a value." << std::endl;
+                return 1;
+            }
+            if (!capture.has_value())
+                capture.emplace();
+            if (arg == "--capture")
+                capture->path = argv[i];
+            else if (arg == "--capture-format") {
+                if (!parse_capture_format(argv[i], capture->format)) {
+                    std::cerr << "Error: --capture-format must be ppm, png or raw." << std::endl;
+                    return 1;
+                }
+            }
+            else {
+                try {
+                    capture->queue_frames = static_cast<u32>(std::stoul(argv[i]));
+                    if (capture->queue_frames == 0 || capture->queue_frames > 1024)
+                        throw std::out_of_range(arg);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: Invalid value provided for " << arg << "." << std::endl;
+                    return 1;
+                }
+            }
+        }
+        else if (arg == "--headless") {
+            headless = true;
+        }
+        else if (arg == "--render-stats") {
+            render_stats = true;
+        }
+        else if (arg == "--renderer") {
+            i++;
+            if (i >= argc || !parse_renderer_kind(argv[i], renderer_kind)) {
+                std::cerr << "Error: --renderer must be one of: vertex, texture." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--controller") {
+            i++;
+            if (i >= argc || !parse_controller_kind(argv[i], controller_kind)) {
+                std::cerr << "Error: --controller must be one of: blind, blind-reach, path, rollout, hamilton, player." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--blind-params") {
+            i++;
+            if (i >= argc || !parse_blind_params(argv[i], blind_params)) {
+                std::cerr << "Error: --blind-params takes laziness=N,keep=N,neutral=N,aligned=N,pocket=N (keep 0 to 256, the last three 1 to 3)." << std::endl;
+                return 1;
+            }
+            blind_params_given = true;
+        }
+        else if (arg == "--tune") {
+            i++;
+            tune = true;
+            if (i >= argc || !parse_tune_search(argv[i], tune_options.search)) {
+                std::cerr << "Error: --tune must be one of: grid, evolve." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--tune-rules") {
+            tune_options.rules = true;
+        }
+        else if (arg == "--tune-games" || arg == "--tune-generations" || arg == "--tune-population") {
+            i++;
+            try {
+                u64 value = std::stoull(argv[i]);
+                if (value == 0 || value > 10000000)
+                    throw std::out_of_range(arg);
+                (arg == "--tune-games" ? tune_options.games : arg == "--tune-generations" ? tune_options.generations : tune_options.population) = static_cast<u32>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Invalid value provided for " << arg << "." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--rollout-budget" || arg == "--rollout-threads") {
+            i++;
+            try {
+                u64 value = std::stoull(argv[i]);
+                if (value == 0 || value > 1000000)
+                    throw std::out_of_range(arg);
+                (arg == "--rollout-budget" ? rollout.budget_us : rollout.threads) = static_cast<u32>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Invalid value provided for " << arg << "." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--batch" || arg == "--threads" || arg == "--seed") {
+            i++;
+            try {
+                u64 value = std::stoull(argv[i]);
+                if (arg == "--batch")
+                    batch_games = static_cast<u32>(value);
+                else if (arg == "--threads")
+                    threads = static_cast<u32>(value);
+                else
+                    seed = value;
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Invalid value provided for " << arg << "." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--lockstep") {
+            i++;
+            try {
+                u64 value = std::stoull(argv[i]);
+                if (value == 0 || value > 65536)
+                    throw std::out_of_range(arg);
+                lockstep_lanes = static_cast<u32>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Invalid value provided for " << arg << "." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--arena" || arg == "--arena-ticks") {
+            i++;
+            try {
+                u64 value = std::stoull(argv[i]);
+                if (value == 0 || value > 0xFFFFFFFFull)
+                    throw std::out_of_range(arg);
+                (arg == "--arena" ? arena_snakes : arena_ticks) = static_cast<u32>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: Invalid value provided for " << arg << "." << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--width" || arg == "--height") {
+            i++;
+            try {
+                u64 value = std::stoull(argv[i]);
+                if (value < 2 || value > MAX_BOARD_LENGTH)
+                    throw std::out_of_range(arg);
+                (arg == "--width" ? width : height) = static_cast<u16>(value);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << arg << " must be between 2 and " << MAX_BOARD_LENGTH << "." << std::endl;
+                return 1;
             }
         }
     }
 
-    bool replay = true;
-    while (replay) {
-        // Initialize tiles (for collision detection and initializing vertex_buffer)
-        u8 tiles[HEIGHT][WIDTH] = {0};
-        for (const auto& p : START_COORDS) {
-            tiles[p[1]][p[0]] = 1;
+    if (width != WIDTH || height != HEIGHT) {
+        highscore_viable = false;
+        std::cout << "Board is not the default " << WIDTH << "x" << HEIGHT << ". Highscore will not be updated." << std::endl;
+    }
+
+    if (controller_kind == ControllerKind::HAMILTON) {
+        highscore_viable = false;
+        std::cout << "The hamilton controller always fills the board. Highscore will not be updated." << std::endl;
+    }
+    else if (controller_kind != ControllerKind::BLIND || blind_params_given) {
+        // The record is the Blind Snake's, so other controllers and tunings would change what it measures
+        highscore_viable = false;
+        std::cout << "The highscore is kept for the blind controller with its default parameters. Highscore will not be updated." << std::endl;
+    }
+
+    if (!record_path.empty() && (batch_games > 0 || !replay_path.empty() || !verify_path.empty())) {
+        std::cerr << "Error: --record can not be combined with --batch, --replay or --verify." << std::endl;
+        return 1;
+    }
+
+    if (lockstep_lanes > 0 && (batch_games == 0 || controller_kind != ControllerKind::BLIND)) {
+        std::cerr << "Error: --lockstep only works with --batch and the blind controller." << std::endl;
+        return 1;
+    }
+
+    // Replays are verified with the default parameters, and lockstep lanes have them built in
+    if (blind_params_given && (!record_path.empty() || lockstep_lanes > 0)) {
+        std::cerr << "Error: --blind-params can not be combined with --record or --lockstep." << std::endl;
+        return 1;
+    }
+
+    if (controller_kind == ControllerKind::HAMILTON && width % 2 != 0 && height % 2 != 0)
+        std::cout << "A " << width << "x" << height << " board has no Hamiltonian cycle. The hamilton controller plays the Blind Snake instead." << std::endl;
+
+    if (capture.has_value() && (capture->path.empty() || headless)) {
+        std::cerr << "Error: --capture needs an output path, and a window (not --headless)." << std::endl;
+        return 1;
+    }
+
+    if (controller_kind == ControllerKind::PLAYER && (headless || batch_games > 0 || tune || arena_snakes > 0)) {
+        std::cerr << "Error: --controller player needs a window (not --headless, --batch, --tune or --arena)." << std::endl;
+        return 1;
+    }
+
+    if (tune && controller_kind != ControllerKind::BLIND && controller_kind != ControllerKind::BLIND_REACHABILITY) {
+        std::cerr << "Error: --tune only works with the blind and blind-reach controllers." << std::endl;
+        return 1;
+    }
+
+    // From here on every mode runs, and returns through this
+    const PhaseStatsOnExit phase_stats_on_exit{stats_path};
+
+    if (tune) {
+        tune_options.controller = controller_kind;
+        tune_options.threads = threads;
+        tune_options.seed = seed.value_or(random_seed());
+        return run_tune_mode(width, height, tune_options);
+    }
+
+    if (arena_snakes > 0) {
+        ArenaOptions options;
+        options.snakes = arena_snakes;
+        options.apples = arena_snakes;
+        options.threads = threads;
+        options.seed = seed.value_or(random_seed());
+        return with_board_dims(width, height, [&](auto dims) { return run_arena_mode(dims, options, arena_ticks); });
+    }
+
+    if (batch_games > 0)
+        return run_batch_mode(batch_games, threads, seed.value_or(random_seed()), controller_kind, rollout, blind_params, lockstep_lanes, width, height);
+
+    // Replays are mapped, not read, so even very long ones open instantly
+    std::unique_ptr<MappedFile> replay_file;
+    std::vector<ReplayGame> replay_games;
+    std::unique_ptr<ReplayRecorder> recorder;
+    try {
+        if (!replay_path.empty() || !verify_path.empty()) {
+            replay_file = std::make_unique<MappedFile>(!verify_path.empty() ? verify_path : replay_path);
+            replay_games = read_replay_games(*replay_file);
         }
+        if (!record_path.empty())
+            recorder = std::make_unique<ReplayRecorder>(record_path);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << "." << std::endl;
+        return 1;
+    }
+
+    if (!verify_path.empty())
+        return run_verify(replay_games);
 
-        // Initialize snake data
-        Snake snake;
-        snake.direction = START_DIRECTION;
-        snake.grow_timer = START_GROW_TIMER;
-        for (const auto& p : START_COORDS) {
-            snake.deque.push_back(p);
+    if (!replay_path.empty()) {
+        if (replay_games.empty()) {
+            std::cerr << "Error: " << replay_path << " has no games." << std::endl;
+            return 1;
+        }
+        if (headless)
+            return run_playback_headless(replay_games);
+
+        // The window plays every game on the board of the first one
+        width = replay_games[0].header.width;
+        height = replay_games[0].header.height;
+        for (const ReplayGame& game : replay_games) {
+            if (game.header.width != width || game.header.height != height) {
+                std::cerr << "Error: The games in " << replay_path << " are not all on the same board size." << std::endl;
+                return 1;
+            }
         }
+        if (!tick_rate_given && replay_games[0].header.tick_rate != 0)
+            tick_rate = replay_games[0].header.tick_rate;
+        highscore_viable = false;
+    }
+
+    int result;
+    try {
+        result = with_board_dims(width, height, [&](auto dims) {
+            if (headless)
+                return run_headless(dims, seed, controller_kind, rollout, blind_params, recorder.get());
+            run_window(dims, WindowOptions{tick_rate, frame_rate, interpolate, highscore_viable, controller_kind, rollout, blind_params, renderer_kind, render_stats,
+                                           seed, recorder.get(), replay_path.empty() ? nullptr : &replay_games, capture});
+            return 0;
+        });
+        // The last writes only land here, so this is where a recording that could not be written shows up
+        if (recorder != nullptr)
+            recorder->close();
+    } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << "." << std::endl;
+        result = 1;
+    }
+    return result;
+}
 
-        // Initialize vertex_buffer
-        sf::VertexBuffer vertex_buffer(sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Stream);
-        generate_vertex_buffer(vertex_buffer, tiles); 
+// Game ticks and frames run on separate clocks. Every frame polls events and adds the time since the last frame
+// to an accumulator, runs as many fixed-length ticks as fit into it, then draws. Input is handled at the frame
+// rate whatever the tick rate, and with --interpolate the leftover fraction of a tick animates the last step
+template<typename D>
+void run_window(const D& dims, const WindowOptions& options) {
+    using clock = std::chrono::steady_clock;
+    const bool highscore_viable = options.highscore_viable;
+    sf::RenderWindow window(sf::VideoMode({WINDOW_WIDTH, WINDOW_HEIGHT}), "Snake", sf::State::Windowed);
+    window.setFramerateLimit(options.frame_rate);
+    window.setVerticalSyncEnabled(false);
+
+    const clock::duration tick_length = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / options.tick_rate));
+    // Time the game may fall behind by (a slow frame, the window being dragged). Anything beyond is dropped
+    // instead of being caught up all at once
+    const clock::duration max_lag = std::max<clock::duration>(tick_length * 4, std::chrono::milliseconds(250));
+
+    BoardRenderer renderer(options.renderer_kind, make_tile_layout(dims.width, dims.height));
+    FrameTimings timings;
+    std::unique_ptr<FrameCapture> capture;
+    if (options.capture.has_value()) {
+        try {
+            capture = std::make_unique<FrameCapture>(options.capture->path, options.capture->format,
+                                                     sf::Vector2u{WINDOW_WIDTH, WINDOW_HEIGHT}, options.capture->queue_frames);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return;
+        }
+    }
+    auto state_ptr = std::make_unique<GameState<D>>(dims);
+    GameState<D>& state = *state_ptr;
+    Controller<D> controller(options.controller_kind, dims, options.rollout, options.blind_params);
+    ReplayRecorder* recorder = options.recorder;
+    u32 game_index = 0;
+    bool replay = true;
+    while (replay && window.isOpen()) {
+        // Either the next recorded game, or a new one for the controller
+        std::optional<ReplayCursor> playback;
+        if (options.playback != nullptr) {
+            if (game_index == options.playback->size())
+                break;
+            playback.emplace((*options.playback)[game_index]);
+            start_playback(state, *playback);
+        }
+        else {
+            if (controller.player != nullptr)
+                controller.player->reset();
+            if (options.seed.has_value() || recorder != nullptr) {
+                u64 game_seed = options.seed.has_value() ? derive_seed(*options.seed, game_index) : random_seed();
+                seed_rng(game_seed);
+                if (recorder != nullptr)
+                    recorder->begin_game(dims.width, dims.height, options.controller_kind, game_seed, options.tick_rate);
+            }
+            init_game(state);
+            if (recorder != nullptr)
+                recorder->record_apple(dims.cell_index(state.apple_position[0], state.apple_position[1]));
+        }
+        game_index++;
 
-        // Apple
-        std::array<u16, 2> apple_position;
-        update_apple(apple_position, vertex_buffer, tiles);
+        // Board colors for the new game
+        renderer.reset(state);
 
         bool died = false;
+        clock::duration accumulator = clock::duration::zero();
+        clock::time_point frame_start = clock::now();
+        clock::time_point last_poll = frame_start;
+        // A key pressed after last_poll is seen by the next poll. The latency of a press is measured from the poll
+        // before the one that saw it, which bounds it from above, to when its action shows on screen
+        std::optional<clock::time_point> input_pending;
         while (window.isOpen() && !died)
         {
-            while (const std::optional event = window.pollEvent())
+            clock::time_point now = clock::now();
+            accumulator = std::min(accumulator + (now - frame_start), max_lag);
+            frame_start = now;
+
             {
-                if (event->is<sf::Event::Closed>())
-                    end_program(window, false, highscore_viable, static_cast<u32>(snake.deque.size()));
-
-                else if (const auto* keyPressed = event->getIf<sf::Event::KeyPressed>()) {
-                    switch (keyPressed->scancode) {
-                        case sf::Keyboard::Scancode::Escape:
-                        case sf::Keyboard::Scancode::Q:
-                        case sf::Keyboard::Scancode::C:
-                            end_program(window, true, highscore_viable, static_cast<u32>(snake.deque.size()));
-                            break;
-                        default:
-                            break;
+                SNAKE_TIME_PHASE(Phase::EVENT_POLL);
+                while (const std::optional event = window.pollEvent())
+                {
+                    if (event->is<sf::Event::Closed>())
+                        end_program(window, false, highscore_viable, snake_length(state));
+
+                    else if (const auto* keyPressed = event->getIf<sf::Event::KeyPressed>()) {
+                        if (!input_pending.has_value())
+                            input_pending = last_poll;
+                        switch (keyPressed->scancode) {
+                            case sf::Keyboard::Scancode::Escape:
+                            case sf::Keyboard::Scancode::Q:
+                            case sf::Keyboard::Scancode::C:
+                                // Acted on right away
+                                if (options.render_stats)
+                                    timings.input_us.push_back(std::chrono::duration<double, std::micro>(clock::now() - *input_pending).count());
+                                input_pending.reset();
+                                end_program(window, true, highscore_viable, snake_length(state));
+                                break;
+                            default:
+                                // Queued and played out by the next ticks in order. SFML events carry no time, so like
+                                // input_us the press counts from the poll before it, the earliest it could have arrived
+                                if (controller.player != nullptr && !playback.has_value()) {
+                                    if (const std::optional<Direction> direction = key_direction(keyPressed->code))
+                                        controller.player->press(*direction, static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(last_poll.time_since_epoch()).count()));
+                                }
+                                break;
+                        }
                     }
                 }
             }
+            last_poll = clock::now();
+            if (!window.isOpen())
+                break;
 
             // ======================== Game logic ======================== //
 
-            // snake.direction = snake_decide(apple_position, snake.deque.back(), snake.direction, tiles);
-            snake.direction = snake_decide(apple_position, snake.deque.back(), snake.direction, tiles);
+            while (accumulator >= tick_length && !died) {
+                accumulator -= tick_length;
 
-            // Get the next head position and check if out of bounds
-            std::array<u16, 2> next_head_position(snake.deque.back());
+                StepEvents events;
+                bool alive;
+                if (playback.has_value()) {
+                    // Also ends the game when the recording runs out with the snake still alive
+                    SNAKE_TIME_PHASE(Phase::STEP);
+                    alive = playback_step(state, *playback, &events);
+                }
+                else {
+                    Direction direction;
+                    {
+                        SNAKE_TIME_PHASE(Phase::DECIDE);
+                        direction = controller.decide(state);
+                    }
+                    {
+                        SNAKE_TIME_PHASE(Phase::STEP);
+                        alive = step(state, direction, &events);
+                    }
+                    if (recorder != nullptr) {
+                        recorder->record_move(direction);
+                        if (events.apple_spawned)
+                            recorder->record_apple(dims.cell_index(state.apple_position[0], state.apple_position[1]));
+                    }
+                }
+                if (!alive)
+                    game_over(highscore_viable, snake_length(state), &died);
 
-            switch (snake.direction) {
-                case UP:    next_head_position[1]++; break;
-                case DOWN:  next_head_position[1]--; break;
-                case RIGHT: next_head_position[0]++; break;
-                case LEFT:  next_head_position[0]--; break;
+                SNAKE_TIME_PHASE(Phase::RENDER_UPDATE);
+                renderer.apply_step(events, state.apple_position);
             }
-            if (next_head_position[0] >= WIDTH || next_head_position[1] >= HEIGHT)
-                game_over(highscore_viable, static_cast<u32>(snake.deque.size()), &died);
-            // Would check for collision here, but tail must be popped first just in case head ends up at the previous tail position 
 
-            // Tail 
-            // Check if growing. If not, pop front (tail) of snake and update vertex_buffer
-            if (snake.grow_timer != 0) 
-                snake.grow_timer--;
-            else {
-                update_vertex_buffer_square_color(vertex_buffer, snake.deque.front()[0], snake.deque.front()[1], sf::Color::Black);
-                tiles[snake.deque.front()[1]][snake.deque.front()[0]] = 0;
-                snake.deque.pop_front();
-            }
+            // ======================== Rendering ======================== //
 
-            // Head
-            // Check for collisions. If none, push the next head position and update vertex_buffer
-            if (tiles[next_head_position[1]][next_head_position[0]] == 1)
-                game_over(highscore_viable, static_cast<u32>(snake.deque.size()), &died);
-            else {
-                update_vertex_buffer_square_color(vertex_buffer, next_head_position[0], next_head_position[1], sf::Color::White);
-                snake.deque.push_back(next_head_position);
-                tiles[next_head_position[1]][next_head_position[0]] = 1;
-            }
+            auto render_start = clock::now();
 
-            // Apple!
-            if (snake.deque.back() == apple_position) {
-                snake.grow_timer += GROW_RATE;
-                update_apple(apple_position, vertex_buffer, tiles);
+            {
+                SNAKE_TIME_PHASE(Phase::RENDER_UPDATE);
+                if (options.interpolate && !died)
+                    renderer.interpolate(std::chrono::duration<float>(accumulator) / tick_length, state.apple_position);
+                renderer.flush();
             }
 
-            // ======================== Rendering ======================== //
+            {
+                SNAKE_TIME_PHASE(Phase::DRAW);
+                // clear the window with black color
+                window.clear(sf::Color::Black);
 
-            // clear the window with black color
-            window.clear(sf::Color::Black);
+                // draw everything here...
+                renderer.draw(window);
+            }
 
-            // draw everything here...
-            window.draw(vertex_buffer);
+            {
+                SNAKE_TIME_PHASE(Phase::DISPLAY);
+                // end the current frame
+                window.display();
+            }
 
-            // end the current frame
-            window.display();
+            if (capture != nullptr) {
+                SNAKE_TIME_PHASE(Phase::CAPTURE);
+                capture->target().clear(sf::Color::Black);
+                renderer.draw(capture->target());
+                capture->capture();
+            }
+
+            auto frame_end = clock::now();
+            if (options.render_stats) {
+                timings.render_us.push_back(std::chrono::duration<double, std::micro>(frame_end - render_start).count());
+                timings.frame_us.push_back(std::chrono::duration<double, std::micro>(frame_end - frame_start).count());
+                if (input_pending.has_value())
+                    timings.input_us.push_back(std::chrono::duration<double, std::micro>(frame_end - *input_pending).count());
+            }
+            input_pending.reset();
         }
+
+        // Games cut short by closing the window are recorded with the snake still alive
+        if (recorder != nullptr && !playback.has_value())
+            recorder->end_game(snake_length(state), state.death_cause);
     }
-}
 
-void set_square_vertices_color(sf::Vertex* vertices, sf::Color color) {
-    for (u8 i = 0; i < 6; ++i) {
-        vertices[i].color = color;
+    if (options.render_stats)
+        print_render_stats(renderer, timings);
+    if (options.render_stats && controller.player != nullptr) {
+        controller.player->reset();
+        print_player_stats(controller.player->stats());
     }
+    if (capture != nullptr)
+        print_capture_stats(capture->finish());
 }
 
-void set_square_vertices_positions(sf::Vertex* vertices, u16 x, u16 y) {
-    float screen_x = x * TILE_LENGTH + OFFSET;
-    float screen_y = y * TILE_LENGTH + OFFSET;
+void print_capture_stats(const CaptureStats& stats) {
+    std::cout << "Capture: " << stats.frames << " frames, " << stats.dropped << " dropped (queue full), "
+              << stats.failed << " failed to read back or write" << std::endl;
+    std::cout << "Capture queue peak " << stats.peak_queued << " of " << stats.queue_capacity << " frames, "
+              << (stats.async_readback ? "asynchronous" : "blocking") << " readback" << std::endl;
+}
 
-    // Four corners of the square
-    sf::Vector2f TL = { screen_x, screen_y };
-    sf::Vector2f TR = { screen_x + SQUARE_LENGTH, screen_y };
-    sf::Vector2f BL = { screen_x, screen_y + SQUARE_LENGTH };
-    sf::Vector2f BR = { screen_x + SQUARE_LENGTH, screen_y + SQUARE_LENGTH };
+void write_phase_stats(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: Could not open " << path << " to write --stats." << std::endl;
+        return;
+    }
+    // The main thread's histograms and those of every worker the mode ran on
+    const PhaseStats stats = merged_phase_stats();
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    if (csv)
+        write_phase_stats_csv(out, stats);
+    else
+        write_phase_stats_json(out, stats);
+}
 
-    vertices[0].position = TL;
-    vertices[1].position = BL;
-    vertices[2].position = BR;
+// sorted_percentile of samples. Sorts samples
+static double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return sorted_percentile(samples, p);
+}
 
-    vertices[3].position = TL;
-    vertices[4].position = BR;
-    vertices[5].position = TR;
+void print_render_stats(const BoardRenderer& renderer, FrameTimings& timings) {
+    double frames = renderer.frames > 0 ? double(renderer.frames) : 1.0;
+    std::cout << "Renderer: " << renderer_kind_name(renderer.kind) << ", " << renderer.frames << " frames" << std::endl;
+    std::cout << "GPU uploads per frame: " << renderer.total.calls / frames
+              << " (" << renderer.total.bytes / frames << " bytes)" << std::endl;
+    std::cout << "Tile changes per frame: " << renderer.tile_changes / frames << std::endl;
+    std::cout << "Render time (flush, draw, display) us  p50 " << percentile(timings.render_us, 0.5)
+              << "  p99 " << percentile(timings.render_us, 0.99) << std::endl;
+    std::cout << "Frame time us  p50 " << percentile(timings.frame_us, 0.5)
+              << "  p99 " << percentile(timings.frame_us, 0.99) << std::endl;
+    std::cout << "Input latency us (" << timings.input_us.size() << " key presses)  p50 " << percentile(timings.input_us, 0.5)
+              << "  p99 " << percentile(timings.input_us, 0.99) << std::endl;
 }
 
-void generate_vertex_buffer(sf::VertexBuffer& vertex_buffer, u8 tiles[HEIGHT][WIDTH]) {
-    sf::VertexArray vertices(sf::PrimitiveType::Triangles, WIDTH * HEIGHT * 6);
+void print_player_stats(PlayerInputStats stats) {
+    std::cout << "Direction keys: " << stats.presses << " pressed, " << stats.applied << " turned the snake, " << stats.rejected
+              << " rejected (reversal or repeat), " << stats.dropped << " dropped (queue full), " << stats.discarded
+              << " still queued when a game ended" << std::endl;
+    const double max_us = stats.latency_us.empty() ? 0 : *std::max_element(stats.latency_us.begin(), stats.latency_us.end());
+    std::cout << "Press to move latency us  p50 " << percentile(stats.latency_us, 0.5) << "  p99 " << percentile(stats.latency_us, 0.99)
+              << "  max " << max_us << std::endl;
+}
 
-    for (usize i = 0; i < WIDTH * HEIGHT; ++i) {
-        u16 x = i % WIDTH;
-        u16 y = i / WIDTH;
+template<typename D>
+int run_headless(const D& dims, std::optional<u64> seed, ControllerKind controller_kind, const RolloutOptions& rollout,
+                 const BlindParams& blind_params, ReplayRecorder* recorder) {
+    if (recorder != nullptr && !seed.has_value())
+        seed = random_seed();
+    if (seed.has_value())
+        seed_rng(seed.value());
+    auto state = std::make_unique<GameState<D>>(dims);
+    Controller<D> controller(controller_kind, dims, rollout, blind_params);
+
+    if (recorder != nullptr)
+        recorder->begin_game(dims.width, dims.height, controller_kind, seed.value(), 0);
+    auto start = std::chrono::steady_clock::now();
+    GameSummary summary = run_headless_game(*state, controller, recorder);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (recorder != nullptr)
+        recorder->end_game(summary.length, summary.death_cause);
+
+    std::cout << "Final length: " << summary.length << std::endl;
+    std::cout << "Ticks survived: " << summary.ticks << std::endl;
+    std::cout << "Cause of death: " << death_cause_name(summary.death_cause) << std::endl;
+    std::cout << "Ticks per second: " << static_cast<u64>(summary.ticks / elapsed.count()) << std::endl;
+    if (controller.rollout != nullptr && controller.rollout->busy_seconds > 0)
+        std::cout << "Rollouts per second: " << static_cast<u64>(controller.rollout->rollouts / controller.rollout->busy_seconds)
+                  << " (" << controller.rollout->options.threads << " threads)" << std::endl;
+    return 0;
+}
 
-        set_square_vertices_positions(&vertices[i * 6], x, y);
+int run_playback_headless(const std::vector<ReplayGame>& games) {
+    u64 total_ticks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (usize i = 0; i < games.size(); ++i) {
+        const ReplayHeader& header = games[i].header;
+        u32 length = with_board_dims(header.width, header.height, [&](auto dims) {
+            auto state = std::make_unique<GameState<decltype(dims)>>(dims);
+            ReplayCursor cursor(games[i]);
+            start_playback(*state, cursor);
+            while (playback_step(*state, cursor)) {}
+            total_ticks += state->ticks;
+            return snake_length(*state);
+        });
+        std::cout << "Game " << i << ": length " << length << ", " << header.ticks << " ticks, "
+                  << death_cause_name(static_cast<DeathCause>(header.death_cause)) << " ("
+                  << controller_kind_name(static_cast<ControllerKind>(header.controller_kind)) << " controller, "
+                  << header.width << "x" << header.height << " board)" << std::endl;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Ticks per second: " << static_cast<u64>(total_ticks / elapsed.count()) << std::endl;
+    return 0;
+}
 
-        if (tiles[y][x] == 1) 
-            set_square_vertices_color(&vertices[i * 6], sf::Color::White);
-        else 
-            set_square_vertices_color(&vertices[i * 6], sf::Color::Black);
+int run_verify(const std::vector<ReplayGame>& games) {
+    u64 total_ticks = 0;
+    usize mismatches = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (usize i = 0; i < games.size(); ++i) {
+        ReplayVerification result = verify_replay(games[i]);
+        total_ticks += result.ticks;
+        if (!result.matches) {
+            mismatches++;
+            std::cout << "Game " << i << ": MISMATCH at " << result.problem << std::endl;
+        }
     }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << games.size() - mismatches << " of " << games.size() << " games match their recording ("
+              << total_ticks << " ticks, " << static_cast<u64>(total_ticks / elapsed.count()) << " ticks per second)" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
 
-    // Create and copy vertices to vertex_buffer
-    if (!vertex_buffer.create(vertices.getVertexCount()))
-        throw(std::runtime_error("Failed to create vertex_buffer of size " + std::to_string(vertices.getVertexCount())));
+template<typename D>
+int run_arena_mode(const D& dims, const ArenaOptions& options, u32 ticks) {
+    Arena<D> arena(options, dims);
+    init_arena(arena);
 
-    if (!vertex_buffer.update(&vertices[0]))
-        throw(std::runtime_error("Failed to copy initial vertex data to vertex_buffer"));
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < ticks; ++i) {
+        arena_tick(arena);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Arena: " << options.snakes << " snakes, " << dims.width << "x" << dims.height << " board, "
+              << options.threads << " threads, seed " << options.seed << std::endl;
+    std::cout << "Ticks: " << arena.stats.ticks << "  deaths " << arena.stats.deaths << "  apples eaten " << arena.stats.apples_eaten << std::endl;
+    std::cout << "Alive at the end: " << arena.alive_count() << "  longest " << arena.longest_snake() << std::endl;
+    std::cout << "Ticks per second: " << ticks / elapsed.count() << "  snake moves per second: " << u64(double(ticks) * options.snakes / elapsed.count()) << std::endl;
+    return 0;
 }
 
-void update_vertex_buffer_square_color(sf::VertexBuffer& vertex_buffer, u16 x, u16 y, sf::Color color) {
-    sf::Vertex vertices[6];
-    set_square_vertices_positions(vertices, x, y);
-    set_square_vertices_color(vertices, color);
-
-    if (!vertex_buffer.update(vertices, 6, (y * WIDTH + x) * 6)) 
-        throw(std::runtime_error("Failed to update vertex_buffer"));
+int run_batch_mode(u32 games, u32 threads, u64 master_seed, ControllerKind controller_kind, const RolloutOptions& rollout,
+                   const BlindParams& blind_params, u32 lockstep_lanes, u16 width, u16 height) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<GameSummary> results = lockstep_lanes > 0
+        ? run_lockstep_batch(games, threads, lockstep_lanes, master_seed, width, height)
+        : run_batch(games, threads, master_seed, controller_kind, width, height, rollout, blind_params);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    BatchStats stats = summarize_batch(results, elapsed.count());
+
+    std::cout << "Games: " << stats.games << " (" << controller_kind_name(controller_kind) << " controller, " << width << "x" << height << " board, " << threads << " threads, seed " << master_seed;
+    if (lockstep_lanes > 0)
+        std::cout << ", " << lockstep_lanes << " lockstep lanes";
+    std::cout << ")" << std::endl;
+    std::cout << "Final length   mean " << stats.mean_length << "  median " << stats.median_length << "  p99 " << stats.p99_length << std::endl;
+    std::cout << "Ticks survived mean " << stats.mean_ticks << "  median " << stats.median_ticks << "  p99 " << stats.p99_ticks << std::endl;
+    std::cout << "Games per second: " << stats.games_per_second << std::endl;
+    return 0;
 }
 
-void update_apple(std::array<u16, 2>& apple_position, sf::VertexBuffer& vertex_buffer, u8 tiles[HEIGHT][WIDTH]) {
-    // TODO: There has to be a better way to do this
-    do {
-        apple_position[0] = random_int(0, WIDTH - 1);
-        apple_position[1] = random_int(0, HEIGHT - 1);
-    } while (tiles[apple_position[1]][apple_position[0]] == 1);
-    update_vertex_buffer_square_color(vertex_buffer, apple_position[0], apple_position[1], sf::Color::Red);
+int run_tune_mode(u16 width, u16 height, const TuneOptions& options) {
+    std::cout << "Tuning the " << controller_kind_name(options.controller) << " controller on a " << width << "x" << height << " board ("
+              << tune_search_name(options.search) << " search, " << options.games << " games per candidate, " << options.threads
+              << " threads, seed " << options.seed << ")" << std::endl;
+
+    auto print_candidate = [&options](const TuneCandidate& candidate) {
+        std::cout << format_blind_params(candidate.blind);
+        if (options.rules)
+            std::cout << "  " << format_game_rules(candidate.rules);
+    };
+    TuneResult result = run_tuner(width, height, options, [&](u32 evaluated, const TuneCandidate& candidate, const TuneScore& score, bool new_best) {
+        if (!new_best)
+            return;
+        std::cout << "Candidate " << evaluated << ": mean length " << score.mean << "  ";
+        print_candidate(candidate);
+        std::cout << std::endl;
+    });
+
+    const TuneScore& best = result.best_score;
+    std::cout << "Best: ";
+    print_candidate(result.best);
+    std::cout << std::endl;
+    std::cout << "Play it with --blind-params " << format_blind_params(result.best.blind);
+    if (options.rules)
+        std::cout << " (the rules are START_GROW_TIMER and GROW_RATE in globals.h)";
+    std::cout << std::endl;
+    std::cout << "Final length   mean " << best.mean << " (defaults " << result.default_score.mean << ")  stddev " << best.stddev
+              << "  min " << best.min << "  p10 " << best.p10 << "  median " << best.median << "  p90 " << best.p90 << "  max " << best.max << std::endl;
+    std::cout << "Board full: " << best.board_full << " of " << best.games << " games" << std::endl;
+    std::cout << "Candidates: " << result.candidates << " (" << result.stopped_early << " stopped early), " << result.games << " games in "
+              << result.seconds << " s" << std::endl;
+    return 0;
 }
@@ -0,0 +1,25 @@
+#include "playerctl.h"
+
+// Player input
+std::optional<Direction> key_direction(sf::Keyboard::Key key) {
+    switch (key) {
+        case sf::Keyboard::Key::W:
+        case sf::Keyboard::Key::K:
+        case sf::Keyboard::Key::Up:
+            return DOWN;
+        case sf::Keyboard::Key::S:
+        case sf::Keyboard::Key::J:
+        case sf::Keyboard::Key::Down:
+            return UP;
+        case sf::Keyboard::Key::D:
+        case sf::Keyboard::Key::L:
+        case sf::Keyboard::Key::Right:
+            return RIGHT;
+        case sf::Keyboard::Key::A:
+        case sf::Keyboard::Key::H:
+        case sf::Keyboard::Key::Left:
+            return LEFT;
+        default:
+            return std::nullopt;
+    }
+}
@@ -0,0 +1,60 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+
+#include "controller.h"
+#include "random_utils.h"
+#include "simulation.h"
+
+// Whole headless games (decide + step every tick) must not touch the heap once the state and controller exist
+// Exits non-zero if any game allocates
+
+// Counts every heap allocation made by this executable
+static std::atomic<u64> allocation_count{0};
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    const ControllerKind kinds[] = {ControllerKind::BLIND, ControllerKind::BLIND_REACHABILITY, ControllerKind::PATHFINDER, ControllerKind::HAMILTON};
+    auto state = std::make_unique<GameState<DefaultDims>>();
+
+    u32 failures = 0;
+    for (ControllerKind kind : kinds) {
+        Controller<DefaultDims> controller(kind);
+        // Longer games take fewer of them
+        const u32 games = (kind == ControllerKind::BLIND || kind == ControllerKind::BLIND_REACHABILITY) ? 100 : 3;
+
+        u64 ticks = 0;
+        u64 allocations = 0;
+        for (u32 game = 0; game < games; ++game) {
+            seed_rng(derive_seed(1, game));
+            const u64 before = allocation_count.load(std::memory_order_relaxed);
+            // Ends starved if the controller loops without eating
+            const GameSummary summary = run_headless_game(*state, controller);
+            allocations += allocation_count.load(std::memory_order_relaxed) - before;
+            ticks += summary.ticks;
+        }
+
+        std::cout << controller_kind_name(kind) << ": " << allocations << " allocations in " << ticks << " ticks" << std::endl;
+        if (allocations != 0) {
+            std::cerr << "The " << controller_kind_name(kind) << " tick loop allocated " << allocations << " times" << std::endl;
+            failures++;
+        }
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
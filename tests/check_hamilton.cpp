@@ -0,0 +1,95 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "hamiltonctl.h"
+#include "random_utils.h"
+#include "simulation.h"
+
+// The hamilton controller must fill every board that has a Hamiltonian cycle, whatever the apples do
+// Exits non-zero on the first game that does not end BOARD_FULL
+
+static u32 failures = 0;
+
+static void expect_full(const std::string& name, const GameState<DynamicDims>& state) {
+    if (state.death_cause == DeathCause::BOARD_FULL)
+        return;
+    std::cerr << name << ": ended " << death_cause_name(state.death_cause) << " at length " << snake_length(state) << std::endl;
+    failures++;
+}
+
+// Seeded games with random apples, as the game plays them
+static void check_seeds(u16 width, u16 height, u64 seed, const std::vector<u32>& games) {
+    DynamicDims dims(width, height);
+    Controller<DynamicDims> controller(ControllerKind::HAMILTON, dims);
+    GameState<DynamicDims> state(dims);
+    for (u32 game : games) {
+        seed_rng(derive_seed(seed, game));
+        run_headless_game(state, controller);
+        expect_full(std::to_string(width) + "x" + std::to_string(height) + " seed " + std::to_string(seed) + " game " + std::to_string(game), state);
+    }
+}
+
+// Most apples respawn on one of the first free tiles ahead of the head along the cycle, so the snake keeps
+// growing while the tiles a shortcut skipped are still empty
+static void check_apples_ahead(u16 width, u16 height, GameRules rules, u32 games) {
+    DynamicDims dims(width, height);
+    Controller<DynamicDims> controller(ControllerKind::HAMILTON, dims);
+    const std::shared_ptr<const HamiltonCycle> cycle = load_hamilton_cycle(width, height);
+    std::vector<u32> cell_at(dims.cells);
+    for (u32 cell = 0; cell < dims.cells; ++cell)
+        cell_at[cycle->position[cell]] = cell;
+
+    GameState<DynamicDims> state(dims);
+    state.rules = rules;
+    for (u32 game = 0; game < games; ++game) {
+        seed_rng(derive_seed(7, game));
+        init_game(state);
+        while (state.ticks - state.last_apple_tick <= starvation_ticks(dims)) {
+            StepEvents events;
+            if (!step(state, controller.decide(state), &events))
+                break;
+            if (!events.apple_spawned || random_int(u32(0), u32(3)) == 0)
+                continue;
+            const u32 head_order = cycle->position[state.snake.body.back()];
+            u32 skip = random_int(u32(0), u32(2));
+            for (u32 k = 1; k < dims.cells; ++k) {
+                const u32 cell = cell_at[(head_order + k) % dims.cells];
+                if (!state.board.test_cell(cell) && skip-- == 0) {
+                    state.apple_position = dims.cell_position(cell);
+                    break;
+                }
+            }
+        }
+        if (state.death_cause == DeathCause::NONE)
+            state.death_cause = DeathCause::STARVED;
+        expect_full(std::to_string(width) + "x" + std::to_string(height) + " grow_rate " + std::to_string(rules.grow_rate) +
+                    " apples ahead game " + std::to_string(game), state);
+    }
+}
+
+int main() {
+    // Two games the first shortcut rule lost, running into its own body at lengths 30 and 32
+    check_seeds(6, 6, 99, {7267, 11294});
+
+    std::vector<u32> games(200);
+    for (u32 game = 0; game < games.size(); ++game)
+        games[game] = game;
+    check_seeds(2, 9, 1, games);
+    check_seeds(7, 8, 1, games);
+    check_seeds(10, 10, 1, games);
+
+    check_apples_ahead(6, 6, GameRules(), 2000);
+    check_apples_ahead(6, 6, GameRules{0, 1}, 2000);
+    check_apples_ahead(4, 4, GameRules{9, 5}, 2000);
+    check_apples_ahead(9, 2, GameRules(), 1000);
+    check_apples_ahead(10, 10, GameRules{2, 2}, 500);
+    check_apples_ahead(12, 7, GameRules{1, 7}, 500);
+
+    if (failures != 0) {
+        std::cerr << failures << " hamilton games did not fill the board" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}